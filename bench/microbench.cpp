@@ -0,0 +1,372 @@
+/* Copyright (c) DingQiang Liu(dingqiangliu@gmail.com), 2012 - 2017 -*- C++ -*- */
+/*
+ * Description: microbenchmark for pivot/unpivot, linked with in-memory stand-in of Vertica SDK in bench/mock, need no database
+ *
+ * Usage: microbench [-r rows] [-s sweep] [-t minSeconds] [-p]
+ *   -r rows: total input rows of each case, default 1000000
+ *   -s sweep: only run sweeps whose name contains this text, eg. "pivot.method"
+ *   -t minSeconds: repeat each case until it takes at least this time, default 0.2
+ *   -p: run with parameter profile=true, and print counters logged by function after each case
+ */
+
+#include "Vertica.h"
+#include <sstream>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+using namespace Vertica;
+using namespace std;
+
+// note: fixed seed, so every run measures same data
+static uint64 randomState = 88172645463325252ULL;
+
+static uint64 nextRandom()
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static string toString(long value)
+{
+    ostringstream ss;
+    ss << value;
+    return ss.str();
+}
+
+// measure types: i(int), f(float), n(numeric(18,2)), N(numeric(30,2)), v(varchar(20)), d(date)
+static void addMeasureType(SizedColumnTypes &types, char measureType, const string &name)
+{
+    switch (measureType)
+    {
+    case 'i': types.addInt(name); break;
+    case 'f': types.addFloat(name); break;
+    case 'n': types.addNumeric(18, 2, name); break;
+    case 'N': types.addNumeric(30, 2, name); break;
+    case 'v': types.addVarchar(20, name); break;
+    case 'd': types.addDate(name); break;
+    default: vt_report_error(0, "unknown measure type [%c]!", measureType);
+    }
+}
+
+static const char *measureTypeName(char measureType)
+{
+    switch (measureType)
+    {
+    case 'i': return "int";
+    case 'f': return "float";
+    case 'n': return "numeric(18,2)";
+    case 'N': return "numeric(30,2)";
+    case 'v': return "varchar(20)";
+    case 'd': return "date";
+    default: return "?";
+    }
+}
+
+static void putRandomValue(MockColumn &column)
+{
+    const VerticaType &type = column.type;
+    vint value = (vint)(nextRandom() % 100000);
+    if (type.isStringType())
+    {
+        column.strs.push_back("v" + toString(value));
+        column.nulls.push_back(false);
+    }
+    else if (type.isFloat())
+    {
+        vfloat f = value / 100.0;
+        uint64 bits;
+        memcpy(&bits, &f, sizeof(bits));
+        column.fixed.push_back(bits);
+    }
+    else if (type.isNumeric())
+    {
+        // note: value is already scaled by 10^scale, higher words are sign extension of positive value
+        for (int i = 0; i < column.nwds() - 1; i++)
+            column.fixed.push_back(0);
+        column.fixed.push_back((uint64)value);
+    }
+    else
+        column.fixed.push_back((uint64)value);
+}
+
+struct BenchCase
+{
+    string sweep;
+    string value;
+    string factory;
+    vector<pair<string, string> > params;
+    SizedColumnTypes types;
+    size_t partitionSize;
+    int columns;
+    int measures;
+    double hitRate;
+    // pivot key types: v(varchar), i(dense int), s(sparse int)
+    char keyType;
+};
+
+// key of pivot column idx
+static string pivotKey(char keyType, int idx)
+{
+    if (keyType == 'v')
+        return "c" + toString(idx);
+    else if (keyType == 's')
+        return toString((long)idx * 1000003);
+    else
+        return toString(idx);
+}
+
+// note: rows of hit rate take one of columns as key, others take key out of columnsFilter
+static void generatePivotRows(MockRows &input, char keyType, int columns, int measures, double hitRate, size_t rows)
+{
+    uint64 hitThreshold = (uint64)(hitRate * 1000000);
+    for (size_t r = 0; r < rows; r++)
+    {
+        MockColumn &keyColumn = input.cols[0];
+        bool hit = nextRandom() % 1000000 < hitThreshold;
+        int idx = (int)(nextRandom() % columns);
+        if (keyType == 'v')
+        {
+            keyColumn.strs.push_back(hit? pivotKey(keyType, idx) : "x" + toString(idx));
+            keyColumn.nulls.push_back(false);
+        }
+        else
+            keyColumn.fixed.push_back(hit? (uint64)strtoll(pivotKey(keyType, idx).c_str(), NULL, 10) : (uint64)(-1 - idx));
+        for (int m = 0; m < measures; m++)
+            putRandomValue(input.cols[m + 1]);
+        input.rows++;
+    }
+}
+
+static void generateUnPivotRows(MockRows &input, size_t rows)
+{
+    for (size_t r = 0; r < rows; r++)
+    {
+        for (size_t i = 0; i < input.cols.size(); i++)
+            putRandomValue(input.cols[i]);
+        input.rows++;
+    }
+}
+
+static BenchCase makePivotCase(const string &sweep, const string &value, int columns, int measures, char measureType, const string &method, size_t partitionSize, 
+                               double hitRate = 1.0, char keyType = 'v')
+{
+    BenchCase c;
+    c.sweep = sweep;
+    c.value = value;
+    c.factory = "PivotFactory";
+    c.partitionSize = partitionSize;
+    c.columns = columns;
+    c.measures = measures;
+    c.hitRate = hitRate;
+    c.keyType = keyType;
+
+    string columnsFilter;
+    for (int i = 0; i < columns; i++)
+        columnsFilter += (i ? "," : "") + pivotKey(keyType, i);
+    c.params.push_back(make_pair(string("columnsFilter"), columnsFilter));
+    c.params.push_back(make_pair(string("method"), method));
+
+    if (keyType == 'v')
+        c.types.addVarchar(20, "key");
+    else
+        c.types.addInt("key");
+    for (int m = 0; m < measures; m++)
+        addMeasureType(c.types, measureType, "measure" + toString(m + 1));
+    return c;
+}
+
+static BenchCase makeUnPivotCase(const string &sweep, const string &value, int columns, char measureType, size_t partitionSize)
+{
+    BenchCase c;
+    c.sweep = sweep;
+    c.value = value;
+    c.factory = "UnPivotFactory";
+    c.partitionSize = partitionSize;
+    c.columns = columns;
+    c.measures = columns;
+    c.hitRate = 1.0;
+    c.keyType = 'v';
+
+    string measureNames;
+    for (int i = 0; i < columns; i++)
+        measureNames += (i ? "," : "") + ("m" + toString(i));
+    c.params.push_back(make_pair(string("measureNames"), measureNames));
+
+    for (int i = 0; i < columns; i++)
+        addMeasureType(c.types, measureType, "m" + toString(i));
+    return c;
+}
+
+// run all partitions of input repeatedly until minSeconds passed, return seconds per pass
+static double runCase(BenchCase &c, MockRows &input, double minSeconds, bool profile, vector<string> &logLines)
+{
+    TransformFunctionFactory *factory = dynamic_cast<TransformFunctionFactory *>(mockFactoryRegistry().at(c.factory));
+    ServerInterface srvInterface;
+    for (size_t i = 0; i < c.params.size(); i++)
+        srvInterface.params.setParameter(c.params[i].first, c.params[i].second);
+    if (profile)
+        srvInterface.params.setParameter("profile", "true");
+
+    SizedColumnTypes outputTypes;
+    factory->getReturnType(srvInterface, c.types, outputTypes);
+    MockRows output(outputTypes);
+
+    TransformFunction *function = factory->createTransformFunction(srvInterface);
+    function->setup(srvInterface, c.types);
+
+    PartitionReader reader;
+    PartitionWriter writer(&output);
+    writer.setDiscard(true);
+    int passes = 0;
+    double elapsed = 0;
+    while (elapsed < minSeconds || passes == 0)
+    {
+        double start = now();
+        for (size_t begin = 0; begin < input.rows; begin += c.partitionSize)
+        {
+            size_t end = begin + c.partitionSize < input.rows ? begin + c.partitionSize : input.rows;
+            reader.reset(&input, begin, end);
+            function->processPartition(srvInterface, reader, writer);
+        }
+        elapsed += now() - start;
+        passes++;
+    }
+
+    function->destroy(srvInterface, c.types);
+    function->~TransformFunction();
+    logLines = srvInterface.logLines;
+    return elapsed / passes;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rows = 1000000;
+    string sweepFilter;
+    double minSeconds = 0.2;
+    bool profile = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rows = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            sweepFilter = argv[++i];
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            minSeconds = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "-p") == 0)
+            profile = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [-r rows] [-s sweep] [-t minSeconds] [-p]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rows == 0)
+        rows = 1;
+
+    // note: each sweep changes one dimension of baseline: 80 columns, 1 int measure, SUM, 100000 rows per partition, 100% hit
+    const int baseColumns = 80;
+    const size_t basePartition = 100000;
+    vector<BenchCase> cases;
+
+    int columnsSweep[] = {10, 80, 400, 1600};
+    for (size_t i = 0; i < sizeof(columnsSweep) / sizeof(columnsSweep[0]); i++)
+        cases.push_back(makePivotCase("pivot.columns", toString(columnsSweep[i]), columnsSweep[i], 1, 'i', "SUM", basePartition));
+    int measuresSweep[] = {1, 2, 4, 8};
+    for (size_t i = 0; i < sizeof(measuresSweep) / sizeof(measuresSweep[0]); i++)
+        cases.push_back(makePivotCase("pivot.measures", toString(measuresSweep[i]), baseColumns, measuresSweep[i], 'i', "SUM", basePartition));
+    const char *typesSweep = "ifnN";
+    for (const char *t = typesSweep; *t; t++)
+        cases.push_back(makePivotCase("pivot.type", measureTypeName(*t), baseColumns, 1, *t, "SUM", basePartition));
+    const char *methodsSweep[] = {"SUM", "COUNT", "MIN", "MAX", "AVG", "FIRST", "LAST", "SUM,MIN,MAX,COUNT,AVG"};
+    for (size_t i = 0; i < sizeof(methodsSweep) / sizeof(methodsSweep[0]); i++)
+        cases.push_back(makePivotCase("pivot.method", methodsSweep[i], baseColumns, 1, 'i', methodsSweep[i], basePartition));
+    size_t partitionsSweep[] = {10, 1000, 100000, 1000000};
+    for (size_t i = 0; i < sizeof(partitionsSweep) / sizeof(partitionsSweep[0]); i++)
+        cases.push_back(makePivotCase("pivot.partition", toString(partitionsSweep[i]), baseColumns, 1, 'i', "SUM", partitionsSweep[i]));
+    double hitSweep[] = {1.0, 0.5, 0.1, 0.0};
+    for (size_t i = 0; i < sizeof(hitSweep) / sizeof(hitSweep[0]); i++)
+        cases.push_back(makePivotCase("pivot.hitRate", toString((long)(hitSweep[i] * 100)) + "%", baseColumns, 1, 'i', "SUM", basePartition, hitSweep[i]));
+    cases.push_back(makePivotCase("pivot.keyType", "varchar", baseColumns, 1, 'i', "SUM", basePartition, 1.0, 'v'));
+    cases.push_back(makePivotCase("pivot.keyType", "int dense", baseColumns, 1, 'i', "SUM", basePartition, 1.0, 'i'));
+    cases.push_back(makePivotCase("pivot.keyType", "int sparse", baseColumns, 1, 'i', "SUM", basePartition, 1.0, 's'));
+    const char *orderedTypesSweep = "idv";
+    const char *orderedMethodsSweep[] = {"FIRST", "LAST", "MAX"};
+    for (const char *t = orderedTypesSweep; *t; t++)
+    {
+        for (size_t i = 0; i < sizeof(orderedMethodsSweep) / sizeof(orderedMethodsSweep[0]); i++)
+            cases.push_back(makePivotCase("pivot.ordered", string(orderedMethodsSweep[i]) + " " + measureTypeName(*t), baseColumns, 1, *t, orderedMethodsSweep[i], basePartition));
+    }
+    // note: wide and sparse output, 1600 columns but only 100 rows per partition
+    const char *formatsSweep[] = {"columns", "packed"};
+    for (size_t i = 0; i < sizeof(formatsSweep) / sizeof(formatsSweep[0]); i++)
+    {
+        BenchCase c = makePivotCase("pivot.format", formatsSweep[i], 1600, 1, 'i', "SUM", 100);
+        c.params.push_back(make_pair(string("outputFormat"), string(formatsSweep[i])));
+        cases.push_back(c);
+    }
+
+    // note: half of rows are out of columns, skipped or accumulated into __other, and only top 10 columns are written with topK
+    const char *otherSweep[] = {"skip", "other", "top10+other"};
+    for (size_t i = 0; i < sizeof(otherSweep) / sizeof(otherSweep[0]); i++)
+    {
+        BenchCase c = makePivotCase("pivot.other", otherSweep[i], baseColumns, 1, 'i', "SUM", basePartition, 0.5);
+        if (i > 0)
+            c.params.push_back(make_pair(string("otherColumn"), string("true")));
+        if (i > 1)
+            c.params.push_back(make_pair(string("topK"), string("10")));
+        cases.push_back(c);
+    }
+
+    int unpivotColumnsSweep[] = {2, 10, 80};
+    for (size_t i = 0; i < sizeof(unpivotColumnsSweep) / sizeof(unpivotColumnsSweep[0]); i++)
+        cases.push_back(makeUnPivotCase("unpivot.columns", toString(unpivotColumnsSweep[i]), unpivotColumnsSweep[i], 'i', basePartition));
+    const char *unpivotTypesSweep = "ifnNvd";
+    for (const char *t = unpivotTypesSweep; *t; t++)
+        cases.push_back(makeUnPivotCase("unpivot.type", measureTypeName(*t), 10, *t, basePartition));
+    size_t unpivotPartitionsSweep[] = {1, 100, 100000};
+    for (size_t i = 0; i < sizeof(unpivotPartitionsSweep) / sizeof(unpivotPartitionsSweep[0]); i++)
+        cases.push_back(makeUnPivotCase("unpivot.partition", toString(unpivotPartitionsSweep[i]), 10, 'i', unpivotPartitionsSweep[i]));
+
+    printf("%-18s %-24s %10s %12s %14s %10s\n", "sweep", "value", "rows", "seconds", "rows/s", "ns/row");
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+        BenchCase &c = cases[i];
+        if (!sweepFilter.empty() && c.sweep.find(sweepFilter) == string::npos)
+            continue;
+
+        MockRows input(c.types);
+        if (c.factory == "PivotFactory")
+            generatePivotRows(input, c.keyType, c.columns, c.measures, c.hitRate, rows);
+        else
+            generateUnPivotRows(input, rows);
+
+        try
+        {
+            vector<string> logLines;
+            double seconds = runCase(c, input, minSeconds, profile, logLines);
+            printf("%-18s %-24s %10lu %12.6f %14.0f %10.2f\n", c.sweep.c_str(), c.value.c_str(), (unsigned long)rows, seconds, rows / seconds, seconds * 1e9 / rows);
+            for (size_t l = 0; l < logLines.size(); l++)
+                printf("    %s\n", logLines[l].c_str());
+        }
+        catch (std::exception &e)
+        {
+            printf("%-18s %-24s ERROR: %s\n", c.sweep.c_str(), c.value.c_str(), e.what());
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,839 @@
+/* Copyright (c) DingQiang Liu(dingqiangliu@gmail.com), 2012 - 2017 -*- C++ -*- */
+/*
+ * Description: in-memory stand-in for the parts of Vertica C++ SDK used by pivot/unpivot, only for microbenchmark without database
+ *
+ * note: values layout is simplified, column-major vectors in MockRows, it is not compatible with real SDK binary.
+ */
+
+#ifndef BENCH_MOCK_VERTICA_H
+#define BENCH_MOCK_VERTICA_H
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <stdexcept>
+#include <algorithm>
+#include <new>
+
+namespace Vertica
+{
+
+typedef int64_t vint;
+typedef int64_t int64;
+typedef uint64_t uint64;
+typedef int32_t int32;
+typedef uint32_t uint32;
+typedef uint16_t uint16;
+typedef uint8_t uint8;
+typedef int8_t int8;
+typedef double vfloat;
+typedef double ifloat;
+typedef uint8_t vbool;
+typedef uint32_t vsize;
+typedef uint32_t Oid;
+typedef int64_t DateADT;
+typedef int64_t TimeADT;
+typedef int64_t Timestamp;
+typedef int64_t TimestampTz;
+typedef int64_t Interval;
+
+const vint vint_null = (vint)0x8000000000000000ULL;
+const vbool vbool_false = 0;
+const vbool vbool_true = 1;
+const vbool vbool_null = 2;
+
+inline vfloat makeFloatNull()
+{
+    uint64 bits = 0x7ffffffffffffffeULL;
+    vfloat f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+const vfloat vfloat_null = makeFloatNull();
+inline bool vfloatIsNull(const vfloat f)
+{
+    uint64 bits;
+    memcpy(&bits, &f, sizeof(f));
+    return bits == 0x7ffffffffffffffeULL;
+}
+inline bool vfloatIsNull(const vfloat *f) { return vfloatIsNull(*f); }
+
+#define VARHDRSZ 4
+
+enum
+{
+    VUnspecOID = 0,
+    BoolOID = 5,
+    Int8OID = 6,
+    Float8OID = 7,
+    CharOID = 8,
+    VarcharOID = 9,
+    DateOID = 10,
+    TimeOID = 11,
+    TimestampOID = 12,
+    TimestampTzOID = 13,
+    IntervalOID = 14,
+    NumericOID = 16,
+    VarbinaryOID = 17,
+    LongVarcharOID = 115,
+    LongVarbinaryOID = 116
+};
+
+class VerticaType
+{
+public:
+    VerticaType(Oid oid = VUnspecOID, int32 typmod = -1): oid(oid), typmod(typmod) {}
+
+    Oid getTypeOid() const { return oid; }
+    int32 getTypeMod() const { return typmod; }
+
+    bool isInt() const { return oid == Int8OID; }
+    bool isFloat() const { return oid == Float8OID; }
+    bool isNumeric() const { return oid == NumericOID; }
+    bool isBool() const { return oid == BoolOID; }
+    bool isDate() const { return oid == DateOID; }
+    bool isTime() const { return oid == TimeOID; }
+    bool isTimestamp() const { return oid == TimestampOID; }
+    bool isTimestampTz() const { return oid == TimestampTzOID; }
+    bool isInterval() const { return oid == IntervalOID; }
+    bool isChar() const { return oid == CharOID; }
+    bool isVarchar() const { return oid == VarcharOID; }
+    bool isLongVarchar() const { return oid == LongVarcharOID; }
+    bool isVarbinary() const { return oid == VarbinaryOID; }
+    bool isLongVarbinary() const { return oid == LongVarbinaryOID; }
+    bool isStringType() const { return isChar() || isVarchar() || isLongVarchar() || isVarbinary() || isLongVarbinary(); }
+
+    int32 getNumericPrecision() const { return ((typmod - VARHDRSZ) >> 16) & 0xffff; }
+    int32 getNumericScale() const { return (typmod - VARHDRSZ) & 0xffff; }
+    int32 getNumericWordCount() const { return getNumericPrecision() / 19 + 1; }
+    int32 getNumericLength() const { return getNumericWordCount() * 8; }
+    int32 getStringLength(bool = true) const { return typmod - VARHDRSZ; }
+    int32 getMaxSize() const
+    {
+        if (isNumeric())
+            return getNumericLength();
+        if (isStringType())
+            return getStringLength();
+        if (isBool())
+            return 1;
+        return 8;
+    }
+
+    static int32 makeNumericTypeMod(int32 precision, int32 scale) { return ((precision << 16) | scale) + VARHDRSZ; }
+    static int32 makeStringTypeMod(int32 len) { return len + VARHDRSZ; }
+
+    const char *getTypeStr() const
+    {
+        switch (oid)
+        {
+        case BoolOID: return "Boolean";
+        case Int8OID: return "Integer";
+        case Float8OID: return "Float";
+        case CharOID: return "Char";
+        case VarcharOID: return "Varchar";
+        case DateOID: return "Date";
+        case TimeOID: return "Time";
+        case TimestampOID: return "Timestamp";
+        case TimestampTzOID: return "TimestampTz";
+        case IntervalOID: return "Interval";
+        case NumericOID: return "Numeric";
+        case VarbinaryOID: return "Varbinary";
+        case LongVarcharOID: return "Long Varchar";
+        case LongVarbinaryOID: return "Long Varbinary";
+        default: return "Unknown";
+        }
+    }
+
+    bool operator==(const VerticaType &o) const { return oid == o.oid && typmod == o.typmod; }
+    bool operator!=(const VerticaType &o) const { return !(*this == o); }
+
+private:
+    Oid oid;
+    int32 typmod;
+};
+
+inline void vt_report_error_impl(int errcode, const char *fmt, ...)
+{
+    char buf[4096];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    (void)errcode;
+    throw std::runtime_error(buf);
+}
+#define vt_report_error(errcode, ...) ::Vertica::vt_report_error_impl(errcode, __VA_ARGS__)
+
+class VString
+{
+public:
+    VString(): ptr(NULL), len(0), null(true), cap(0) {}
+
+    bool isNull() const { return null; }
+    vsize length() const { return null ? 0 : len; }
+    const char *data() const { return ptr; }
+    char *data() { return ptr; }
+    std::string str() const { return null ? std::string() : std::string(ptr, len); }
+
+    void setNull() { null = true; len = 0; }
+    void copy(const char *s, vsize n)
+    {
+        if (n > cap)
+            vt_report_error(0, "mock VString overflow: %u > %u", (unsigned)n, (unsigned)cap);
+        memcpy(ptr, s, n);
+        len = n;
+        null = false;
+    }
+    void copy(const char *s) { copy(s, (vsize)strlen(s)); }
+    void copy(const std::string &s) { copy(s.data(), (vsize)s.size()); }
+    void copy(const VString *from)
+    {
+        if (from->isNull())
+            setNull();
+        else
+            copy(from->data(), from->length());
+    }
+    void copy(const VString &from) { copy(&from); }
+
+    // mock plumbing
+    void bindRead(const char *p, vsize n, bool isnull) { ptr = const_cast<char *>(p); len = n; null = isnull; cap = 0; }
+    void bindWrite(char *p, vsize capacity) { ptr = p; cap = capacity; len = 0; null = true; }
+
+private:
+    char *ptr;
+    vsize len;
+    bool null;
+    vsize cap;
+};
+
+class VNumeric
+{
+public:
+    uint64 *words;
+    int32 nwds;
+    int32 precision;
+    int32 scale;
+
+    VNumeric(uint64 *words, int32 precision, int32 scale): words(words), nwds(precision / 19 + 1), precision(precision), scale(scale) {}
+    VNumeric(uint64 *words, int32 typmod): words(words), precision(((typmod - VARHDRSZ) >> 16) & 0xffff), scale((typmod - VARHDRSZ) & 0xffff)
+    {
+        nwds = precision / 19 + 1;
+    }
+
+    bool isNull() const
+    {
+        if (words[0] != 0x8000000000000000ULL)
+            return false;
+        for (int i = 1; i < nwds; i++)
+            if (words[i] != 0)
+                return false;
+        return true;
+    }
+    void setNull()
+    {
+        words[0] = 0x8000000000000000ULL;
+        for (int i = 1; i < nwds; i++)
+            words[i] = 0;
+    }
+    bool isZero() const
+    {
+        for (int i = 0; i < nwds; i++)
+            if (words[i] != 0)
+                return false;
+        return true;
+    }
+    bool isNeg() const { return (int64)words[0] < 0; }
+    void copy(const VNumeric *from)
+    {
+        // sign extend from shorter inputs
+        int off = nwds - from->nwds;
+        if (off >= 0)
+        {
+            uint64 ext = ((int64)from->words[0] < 0 && !from->isNull()) ? ~0ULL : 0;
+            for (int i = 0; i < off; i++)
+                words[i] = ext;
+            memcpy(words + off, from->words, from->nwds * sizeof(uint64));
+            if (from->isNull())
+                setNull();
+        }
+        else
+            memcpy(words, from->words - off, nwds * sizeof(uint64));
+    }
+    void copy(const VNumeric &from) { copy(&from); }
+    void accumulate(const VNumeric *from)
+    {
+        unsigned __int128 carry = 0;
+        int fi = from->nwds - 1;
+        uint64 ext = ((int64)from->words[0] < 0) ? ~0ULL : 0;
+        for (int i = nwds - 1; i >= 0; i--, fi--)
+        {
+            uint64 f = fi >= 0 ? from->words[fi] : ext;
+            unsigned __int128 s = (unsigned __int128)words[i] + f + carry;
+            words[i] = (uint64)s;
+            carry = s >> 64;
+        }
+    }
+    ifloat toFloat() const
+    {
+        if (isNull())
+            return vfloat_null;
+        // two's complement multiword to double
+        bool neg = isNeg();
+        std::vector<uint64> w(words, words + nwds);
+        if (neg)
+        {
+            for (int i = 0; i < nwds; i++)
+                w[i] = ~w[i];
+            for (int i = nwds - 1; i >= 0; i--)
+                if (++w[i] != 0)
+                    break;
+        }
+        double v = 0;
+        for (int i = 0; i < nwds; i++)
+            v = v * 18446744073709551616.0 + (double)w[i];
+        v /= pow(10.0, scale);
+        return neg ? -v : v;
+    }
+    bool copy(ifloat value, bool = true)
+    {
+        if (vfloatIsNull(value))
+        {
+            setNull();
+            return true;
+        }
+        long double scaled = (long double)value * powl(10.0L, scale);
+        int64 v = (int64)llroundl(scaled);
+        uint64 ext = v < 0 ? ~0ULL : 0;
+        for (int i = 0; i < nwds - 1; i++)
+            words[i] = ext;
+        words[nwds - 1] = (uint64)v;
+        return true;
+    }
+};
+
+class SizedColumnTypes
+{
+public:
+    size_t getColumnCount() const { return types.size(); }
+    const VerticaType &getColumnType(size_t idx) const { return types.at(idx); }
+    const std::string &getColumnName(size_t idx) const { return names.at(idx); }
+
+    void addArg(const VerticaType &t, const std::string &name = "") { push(t, name, argCols); }
+    void addInt(const std::string &name = "") { addArg(VerticaType(Int8OID, -1), name); }
+    void addFloat(const std::string &name = "") { addArg(VerticaType(Float8OID, -1), name); }
+    void addBool(const std::string &name = "") { addArg(VerticaType(BoolOID, -1), name); }
+    void addDate(const std::string &name = "") { addArg(VerticaType(DateOID, -1), name); }
+    void addTime(int32 = -1, const std::string &name = "") { addArg(VerticaType(TimeOID, -1), name); }
+    void addTimestamp(int32 = -1, const std::string &name = "") { addArg(VerticaType(TimestampOID, -1), name); }
+    void addTimestampTz(int32 = -1, const std::string &name = "") { addArg(VerticaType(TimestampTzOID, -1), name); }
+    void addNumeric(int32 precision, int32 scale, const std::string &name = "")
+    {
+        addArg(VerticaType(NumericOID, VerticaType::makeNumericTypeMod(precision, scale)), name);
+    }
+    void addVarchar(int32 len, const std::string &name = "") { addArg(VerticaType(VarcharOID, VerticaType::makeStringTypeMod(len)), name); }
+    void addChar(int32 len, const std::string &name = "") { addArg(VerticaType(CharOID, VerticaType::makeStringTypeMod(len)), name); }
+    void addLongVarchar(int32 len, const std::string &name = "") { addArg(VerticaType(LongVarcharOID, VerticaType::makeStringTypeMod(len)), name); }
+    void addVarbinary(int32 len, const std::string &name = "") { addArg(VerticaType(VarbinaryOID, VerticaType::makeStringTypeMod(len)), name); }
+    void addLongVarbinary(int32 len, const std::string &name = "") { addArg(VerticaType(LongVarbinaryOID, VerticaType::makeStringTypeMod(len)), name); }
+
+    void addPartitionColumn(const VerticaType &t, const std::string &name = "") { push(t, name, pbyCols); }
+    void addVarcharPartitionColumn(int32 len, const std::string &name = "")
+    {
+        push(VerticaType(VarcharOID, VerticaType::makeStringTypeMod(len)), name, pbyCols);
+    }
+    void addOrderColumn(const VerticaType &t, const std::string &name = "") { push(t, name, obyCols); }
+
+    void getArgumentColumns(std::vector<size_t> &cols) const { cols = argCols; }
+    void getPartitionByColumns(std::vector<size_t> &cols) const { cols = pbyCols; }
+    void getOrderByColumns(std::vector<size_t> &cols) const { cols = obyCols; }
+
+private:
+    void push(const VerticaType &t, const std::string &name, std::vector<size_t> &kind)
+    {
+        kind.push_back(types.size());
+        types.push_back(t);
+        names.push_back(name);
+    }
+
+    std::vector<VerticaType> types;
+    std::vector<std::string> names;
+    std::vector<size_t> argCols, pbyCols, obyCols;
+};
+
+class ColumnTypes
+{
+public:
+    void addAny() { types.push_back(VerticaType(VUnspecOID)); }
+    void addInt() { types.push_back(VerticaType(Int8OID)); }
+    void addFloat() { types.push_back(VerticaType(Float8OID)); }
+    void addBool() { types.push_back(VerticaType(BoolOID)); }
+    void addVarchar() { types.push_back(VerticaType(VarcharOID)); }
+    void addVarbinary() { types.push_back(VerticaType(VarbinaryOID)); }
+    void addLongVarbinary() { types.push_back(VerticaType(LongVarbinaryOID)); }
+    void addNumeric() { types.push_back(VerticaType(NumericOID)); }
+    size_t getColumnCount() const { return types.size(); }
+
+private:
+    std::vector<VerticaType> types;
+};
+
+class VTAllocator
+{
+public:
+    virtual ~VTAllocator()
+    {
+        for (size_t i = 0; i < blocks.size(); i++)
+            free(blocks[i]);
+    }
+    virtual void *alloc(size_t size)
+    {
+        void *p = NULL;
+        if (posix_memalign(&p, 16, size ? size : 1) != 0)
+            throw std::bad_alloc();
+        blocks.push_back(p);
+        return p;
+    }
+
+private:
+    std::vector<void *> blocks;
+};
+
+#define vt_createFuncObj(allocator, type, ...) new ((allocator)->alloc(sizeof(type))) type(__VA_ARGS__)
+#define vt_createFuncObject vt_createFuncObj
+
+// parameters are kept as text, and converted on each getXXXRef
+class ParamReader
+{
+public:
+    bool containsParameter(const std::string &name) const { return values.count(name) > 0; }
+    void setParameter(const std::string &name, const std::string &value) { values[name] = value; }
+    const VString &getStringRef(const std::string &name)
+    {
+        if (!containsParameter(name))
+            vt_report_error(0, "mock: no parameter [%s]", name.c_str());
+        std::string &v = values[name];
+        VString &s = strings[name];
+        s.bindRead(v.data(), (vsize)v.size(), false);
+        return s;
+    }
+    const vint &getIntRef(const std::string &name)
+    {
+        ints[name] = strtoll(getStringRef(name).str().c_str(), NULL, 10);
+        return ints[name];
+    }
+    const vfloat &getFloatRef(const std::string &name)
+    {
+        floats[name] = strtod(getStringRef(name).str().c_str(), NULL);
+        return floats[name];
+    }
+    const vbool &getBoolRef(const std::string &name)
+    {
+        std::string v = getStringRef(name).str();
+        std::transform(v.begin(), v.end(), v.begin(), ::tolower);
+        bools[name] = (v == "true" || v == "t" || v == "1" || v == "yes") ? vbool_true : vbool_false;
+        return bools[name];
+    }
+
+private:
+    std::map<std::string, std::string> values;
+    std::map<std::string, VString> strings;
+    std::map<std::string, vint> ints;
+    std::map<std::string, vfloat> floats;
+    std::map<std::string, vbool> bools;
+};
+
+class ServerInterface
+{
+public:
+    ServerInterface(): allocator(&defaultAllocator), logEnabled(false) {}
+    virtual ~ServerInterface() {}
+
+    VTAllocator *allocator;
+    ParamReader params;
+    bool logEnabled;
+    std::vector<std::string> logLines;
+
+    ParamReader getParamReader() { return params; }
+    void log(const char *fmt, ...)
+    {
+        char buf[4096];
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        logLines.push_back(buf);
+        if (logEnabled)
+            fprintf(stderr, "%s\n", buf);
+    }
+
+private:
+    VTAllocator defaultAllocator;
+};
+
+struct VResources
+{
+    VResources(): scratchMemory(0), nFileHandles(0) {}
+    vint scratchMemory;
+    vint nFileHandles;
+};
+
+// column-major in-memory table used by readers/writers
+class MockColumn
+{
+public:
+    explicit MockColumn(const VerticaType &t): type(t) {}
+
+    VerticaType type;
+    std::vector<uint64> fixed;      // int/float/date/timestamp/bool(1 word per row), numeric(nwds words per row)
+    std::vector<std::string> strs;  // strings
+    std::vector<bool> nulls;        // string nulls
+    int nwds() const { return type.isNumeric() ? type.getNumericWordCount() : 1; }
+};
+
+class MockRows
+{
+public:
+    explicit MockRows(const SizedColumnTypes &types): types(types), rows(0)
+    {
+        for (size_t i = 0; i < types.getColumnCount(); i++)
+            cols.push_back(MockColumn(types.getColumnType(i)));
+    }
+
+    SizedColumnTypes types;
+    std::vector<MockColumn> cols;
+    size_t rows;
+
+    void clear()
+    {
+        for (size_t i = 0; i < cols.size(); i++)
+        {
+            cols[i].fixed.clear();
+            cols[i].strs.clear();
+            cols[i].nulls.clear();
+        }
+        rows = 0;
+    }
+};
+
+class BlockReaderBase
+{
+public:
+    BlockReaderBase(MockRows *data = NULL, size_t begin = 0, size_t end = 0): data(data), begin(begin), end(end), cur(begin)
+    {
+        if (data)
+            bind();
+    }
+    virtual ~BlockReaderBase() {}
+
+    size_t getNumCols() const { return data->cols.size(); }
+    int getNumRows() const { return (int)(end - begin); }
+    const SizedColumnTypes &getTypeMetaData() const { return data->types; }
+
+    const vint &getIntRef(size_t idx) { return *reinterpret_cast<const vint *>(&data->cols.at(idx).fixed[cur]); }
+    const vfloat &getFloatRef(size_t idx) { return *reinterpret_cast<const vfloat *>(&data->cols.at(idx).fixed[cur]); }
+    const vbool &getBoolRef(size_t idx) { return *reinterpret_cast<const vbool *>(&data->cols.at(idx).fixed[cur]); }
+    const DateADT &getDateRef(size_t idx) { return getIntRef(idx); }
+    const Timestamp &getTimestampRef(size_t idx) { return getIntRef(idx); }
+    const TimestampTz &getTimestampTzRef(size_t idx) { return getIntRef(idx); }
+    const TimeADT &getTimeRef(size_t idx) { return getIntRef(idx); }
+    const VString &getStringRef(size_t idx)
+    {
+        MockColumn &c = data->cols.at(idx);
+        strs[idx].bindRead(c.strs[cur].data(), (vsize)c.strs[cur].size(), c.nulls[cur]);
+        return strs[idx];
+    }
+    const VNumeric *getNumericPtr(size_t idx)
+    {
+        MockColumn &c = data->cols.at(idx);
+        nums[idx].words = &c.fixed[cur * c.nwds()];
+        return &nums[idx];
+    }
+    const VNumeric &getNumericRef(size_t idx) { return *getNumericPtr(idx); }
+
+    bool next()
+    {
+        if (cur + 1 >= end)
+            return false;
+        cur++;
+        return true;
+    }
+
+    // note: only rebind when table changed, so moving to next partition is cheap
+    void reset(MockRows *d, size_t b, size_t e)
+    {
+        begin = b;
+        end = e;
+        cur = b;
+        if (d != data)
+        {
+            data = d;
+            bind();
+        }
+    }
+
+protected:
+    void bind()
+    {
+        strs.assign(data->cols.size(), VString());
+        nums.clear();
+        for (size_t i = 0; i < data->cols.size(); i++)
+        {
+            const VerticaType &t = data->cols[i].type;
+            nums.push_back(t.isNumeric() ? VNumeric(NULL, t.getNumericPrecision(), t.getNumericScale()) : VNumeric(NULL, 0, 0));
+        }
+    }
+
+    MockRows *data;
+    size_t begin, end, cur;
+    std::vector<VString> strs;
+    std::vector<VNumeric> nums;
+};
+
+class PartitionReader: public BlockReaderBase
+{
+public:
+    PartitionReader(MockRows *data = NULL, size_t begin = 0, size_t end = 0): BlockReaderBase(data, begin, end) {}
+};
+
+class BlockReader: public BlockReaderBase
+{
+public:
+    BlockReader(MockRows *data = NULL, size_t begin = 0, size_t end = 0): BlockReaderBase(data, begin, end) {}
+};
+
+class BlockWriterBase
+{
+public:
+    explicit BlockWriterBase(MockRows *out = NULL): out(out), discard(false)
+    {
+        if (out)
+            bind();
+    }
+    virtual ~BlockWriterBase() {}
+
+    size_t getNumCols() const { return out->cols.size(); }
+    const SizedColumnTypes &getTypeMetaData() const { return out->types; }
+
+    void setInt(size_t idx, vint v) { setFixed(idx, (uint64)v); }
+    void setFloat(size_t idx, vfloat v)
+    {
+        uint64 bits;
+        memcpy(&bits, &v, sizeof(bits));
+        setFixed(idx, bits);
+    }
+    void setBool(size_t idx, vbool v) { setFixed(idx, v); }
+    void setDate(size_t idx, DateADT v) { setFixed(idx, (uint64)v); }
+    void setTime(size_t idx, TimeADT v) { setFixed(idx, (uint64)v); }
+    void setTimestamp(size_t idx, Timestamp v) { setFixed(idx, (uint64)v); }
+    void setTimestampTz(size_t idx, TimestampTz v) { setFixed(idx, (uint64)v); }
+    void setNull(size_t idx)
+    {
+        const VerticaType &t = out->cols.at(idx).type;
+        if (t.isStringType())
+            strs[idx].setNull();
+        else if (t.isNumeric())
+            nums[idx].setNull();
+        else if (t.isFloat())
+            setFloat(idx, vfloat_null);
+        else if (t.isBool())
+            setBool(idx, vbool_null);
+        else
+            setInt(idx, vint_null);
+    }
+    VString &getStringRef(size_t idx) { return strs.at(idx); }
+    VNumeric &getNumericRef(size_t idx) { return nums.at(idx); }
+    void copyFromInput(size_t dstIdx, BlockReaderBase &in, size_t srcIdx)
+    {
+        const VerticaType &t = out->cols.at(dstIdx).type;
+        if (t.isStringType())
+            strs[dstIdx].copy(&in.getStringRef(srcIdx));
+        else if (t.isNumeric())
+            nums[dstIdx].copy(in.getNumericPtr(srcIdx));
+        else
+            setFixed(dstIdx, (uint64)in.getIntRef(srcIdx));
+    }
+
+    void next()
+    {
+        if (discard)
+        {
+            out->rows++;
+            return;
+        }
+        for (size_t i = 0; i < out->cols.size(); i++)
+        {
+            MockColumn &c = out->cols[i];
+            if (c.type.isStringType())
+            {
+                c.strs.push_back(strs[i].isNull() ? std::string() : strs[i].str());
+                c.nulls.push_back(strs[i].isNull());
+            }
+            else if (c.type.isNumeric())
+                c.fixed.insert(c.fixed.end(), nums[i].words, nums[i].words + c.nwds());
+            else
+                c.fixed.push_back(row[i]);
+        }
+        out->rows++;
+        resetRow();
+    }
+
+    void reset(MockRows *o)
+    {
+        out = o;
+        bind();
+    }
+
+    // note: only count output rows, so benchmark measures function itself instead of materializing output
+    void setDiscard(bool value) { discard = value; }
+
+protected:
+    void setFixed(size_t idx, uint64 v) { row.at(idx) = v; }
+    void bind()
+    {
+        size_t n = out->cols.size();
+        row.assign(n, 0);
+        strs.assign(n, VString());
+        strbufs.assign(n, std::vector<char>());
+        numbufs.assign(n, std::vector<uint64>());
+        nums.clear();
+        for (size_t i = 0; i < n; i++)
+        {
+            const VerticaType &t = out->cols[i].type;
+            if (t.isStringType())
+            {
+                strbufs[i].resize(t.getStringLength() > 0 ? t.getStringLength() : 1);
+                strs[i].bindWrite(&strbufs[i][0], (vsize)strbufs[i].size());
+            }
+            numbufs[i].resize(t.isNumeric() ? t.getNumericWordCount() : 1);
+            nums.push_back(t.isNumeric() ? VNumeric(&numbufs[i][0], t.getNumericPrecision(), t.getNumericScale())
+                                         : VNumeric(&numbufs[i][0], 0, 0));
+        }
+        resetRow();
+    }
+    void resetRow()
+    {
+        for (size_t i = 0; i < out->cols.size(); i++)
+            setNull(i);
+    }
+
+    MockRows *out;
+    bool discard;
+    std::vector<uint64> row;
+    std::vector<VString> strs;
+    std::vector<std::vector<char> > strbufs;
+    std::vector<std::vector<uint64> > numbufs;
+    std::vector<VNumeric> nums;
+};
+
+class PartitionWriter: public BlockWriterBase
+{
+public:
+    explicit PartitionWriter(MockRows *out = NULL): BlockWriterBase(out) {}
+};
+
+class BlockWriter: public BlockWriterBase
+{
+public:
+    explicit BlockWriter(MockRows *out = NULL): BlockWriterBase(out) {}
+
+    // result of scalar function is the only output column
+    using BlockWriterBase::getStringRef;
+    VString &getStringRef() { return strs.at(0); }
+};
+
+class UDXObject
+{
+public:
+    virtual ~UDXObject() {}
+    virtual void setup(ServerInterface &, const SizedColumnTypes &) {}
+    virtual void destroy(ServerInterface &, const SizedColumnTypes &) {}
+};
+
+class TransformFunction: public UDXObject
+{
+public:
+    virtual void processPartition(ServerInterface &srvInterface, PartitionReader &input_reader, PartitionWriter &output_writer) = 0;
+    virtual void cancel(ServerInterface &) {}
+};
+
+class ScalarFunction: public UDXObject
+{
+public:
+    virtual void processBlock(ServerInterface &srvInterface, BlockReader &arg_reader, BlockWriter &res_writer) = 0;
+};
+
+class UDXFactory
+{
+public:
+    virtual ~UDXFactory() {}
+    virtual void getParameterType(ServerInterface &, SizedColumnTypes &) {}
+    virtual void getPerInstanceResources(ServerInterface &, VResources &) {}
+    virtual void getPerInstanceResources(ServerInterface &srvInterface, VResources &res, const SizedColumnTypes &)
+    {
+        getPerInstanceResources(srvInterface, res);
+    }
+};
+
+class TransformFunctionFactory: public UDXFactory
+{
+public:
+    virtual void getPrototype(ServerInterface &srvInterface, ColumnTypes &argTypes, ColumnTypes &returnType) = 0;
+    virtual void getReturnType(ServerInterface &srvInterface, const SizedColumnTypes &argTypes, SizedColumnTypes &returnType) = 0;
+    virtual TransformFunction *createTransformFunction(ServerInterface &srvInterface) = 0;
+};
+
+class TransformFunctionPhase
+{
+public:
+    TransformFunctionPhase(): prepass(false) {}
+    virtual ~TransformFunctionPhase() {}
+    virtual void getReturnType(ServerInterface &srvInterface, const SizedColumnTypes &inputTypes, SizedColumnTypes &outputTypes) = 0;
+    virtual TransformFunction *createTransformFunction(ServerInterface &srvInterface) = 0;
+    void setPrepass() { prepass = true; }
+    bool isPrepass() const { return prepass; }
+
+private:
+    bool prepass;
+};
+
+class MultiPhaseTransformFunctionFactory: public UDXFactory
+{
+public:
+    virtual void getPrototype(ServerInterface &srvInterface, ColumnTypes &argTypes, ColumnTypes &returnType) = 0;
+    virtual void getPhases(ServerInterface &srvInterface, std::vector<TransformFunctionPhase *> &phases) = 0;
+};
+
+class ScalarFunctionFactory: public UDXFactory
+{
+public:
+    virtual void getPrototype(ServerInterface &srvInterface, ColumnTypes &argTypes, ColumnTypes &returnType) = 0;
+    virtual void getReturnType(ServerInterface &srvInterface, const SizedColumnTypes &argTypes, SizedColumnTypes &returnType) = 0;
+    virtual ScalarFunction *createScalarFunction(ServerInterface &srvInterface) = 0;
+};
+
+// factory registry, so benchmark can find factories by class name
+inline std::map<std::string, UDXFactory *> &mockFactoryRegistry()
+{
+    static std::map<std::string, UDXFactory *> registry;
+    return registry;
+}
+
+struct MockFactoryRegistrar
+{
+    MockFactoryRegistrar(const char *name, UDXFactory *factory) { mockFactoryRegistry()[name] = factory; }
+};
+
+#define RegisterFactory(FactoryClass) \
+    static FactoryClass FactoryClass##_instance; \
+    static ::Vertica::MockFactoryRegistrar FactoryClass##_registrar(#FactoryClass, &FactoryClass##_instance)
+
+} // namespace Vertica
+
+#endif // BENCH_MOCK_VERTICA_H
@@ -0,0 +1,126 @@
+#!/bin/sh
+# Copyright (c) DingQiang Liu(dingqiangliu@gmail.com), 2012 - 2017
+#
+# End-to-end benchmark in database: generate synthetic fact tables, time pivot against SUM(DECODE(...)) and unpivot against UNION ALL,
+# print results as CSV and keep them in table pivot_bench.results, so regressions and the break-even of UDx and plain SQL can be found.
+#
+# Usage: sqlbench.sh
+#   environment variables:
+#     VSQL:    vsql command, default value is /opt/vertica/bin/vsql
+#     ROWS:    rows of fact tables, default value is "1000000 10000000"
+#     WIDTHS:  pivot columns, default value is "10 100 1000"
+#     DENSITY: keys of each group, dense(each group has 10 rows per column, so all columns are set) or sparse(10 rows per 100 columns, so about 10% columns are set), default value is "dense sparse"
+#     REPEAT:  runs of each query, best one is kept, default value is 3
+#     KEEP:    keep generated tables when it's 1, default value is 0
+#
+# note: each query is timed by the client including its connection, and its output is discarded, so that rows and cells sent
+#  to client cost same for UDx and SQL. Tables are generated deterministically by hash of row number, runs are comparable.
+
+VSQL=${VSQL:-/opt/vertica/bin/vsql}
+ROWS=${ROWS:-"1000000 10000000"}
+WIDTHS=${WIDTHS:-"10 100 1000"}
+DENSITY=${DENSITY:-"dense sparse"}
+REPEAT=${REPEAT:-3}
+KEEP=${KEEP:-0}
+
+SCHEMA=pivot_bench
+RUN_AT=$(date '+%Y-%m-%d %H:%M:%S')
+CSV=$(mktemp /tmp/pivot_bench.XXXXXX)
+SQL=$(mktemp /tmp/pivot_bench_sql.XXXXXX)
+trap 'rm -f "$CSV" "$SQL"' EXIT
+
+vsql() {
+  $VSQL -X -A -q -t -v ON_ERROR_STOP=1 "$@"
+}
+
+now_ms() {
+  echo $(( $(date '+%s%N') / 1000000 ))
+}
+
+# run the query in file $SQL REPEAT times, print the best elapsed milliseconds
+time_query() {
+  best=""
+  i=0
+  while [ $i -lt $REPEAT ] ; do
+    start=$(now_ms)
+    vsql -f "$SQL" -o /dev/null || return 1
+    elapsed=$(( $(now_ms) - start ))
+    if [ -z "$best" ] || [ $elapsed -lt $best ] ; then
+      best=$elapsed
+    fi
+    i=$(( i + 1 ))
+  done
+  echo $best
+}
+
+# sequence "from..to" as list separated by $3 of items "$1<n>$2"
+seq_list() {
+  awk -v from=$1 -v to=$2 -v pre="$3" -v post="$4" -v sep="$5" 'BEGIN { for (n = from; n <= to; n++) printf "%s%s%d%s", (n > from ? sep : ""), pre, n, post }'
+}
+
+# record one result: suite, query, rows, width, density, groups, milliseconds
+record() {
+  echo "$RUN_AT,$1,$2,$3,$4,$5,$6,$7" | tee -a "$CSV"
+}
+
+
+vsql -c "create schema if not exists $SCHEMA;" || exit 1
+vsql -c "create table if not exists $SCHEMA.results(run_at timestamp, suite varchar(20), query varchar(40), rows int, width int, density varchar(10), groups int, milliseconds int);" || exit 1
+
+echo "run_at,suite,query,rows,width,density,groups,milliseconds"
+for rows in $ROWS ; do
+  for width in $WIDTHS ; do
+    for density in $DENSITY ; do
+      if [ "$density" = "dense" ] ; then
+        groupRows=$(( width * 10 ))
+      else
+        groupRows=$(( width / 10 ))
+        [ $groupRows -lt 1 ] && groupRows=1
+      fi
+      groups=$(( (rows + groupRows - 1) / groupRows ))
+      fact=$SCHEMA.fact_${rows}_${width}_${density}
+      wide=$SCHEMA.wide_${rows}_${width}_${density}
+
+      # fact(grp, key, val): key in 0..width-1, val in 0..999
+      vsql -c "drop table if exists $fact cascade;
+        create table $fact as
+        select floor(id / $groupRows)::int as grp, mod(hash(id, 1), $width)::int as key, mod(hash(id, 2), 1000)::int as val
+        from (select row_number() over() - 1 as id from (
+            select ts from (select '2000-01-01 00:00:00'::timestamp as t union all select '2000-01-01 00:00:00'::timestamp + ($rows - 1) * interval '1 second') s
+            timeseries ts as '1 second' over (order by t)
+          ) g
+        ) r
+        order by grp segmented by hash(grp) all nodes;
+        select analyze_statistics('$fact');" -o /dev/null || exit 1
+
+      echo "select grp, pivot(key, val using parameters columnsRange = '0..$(( width - 1 ))') over(partition by grp) from $fact;" > "$SQL"
+      ms=$(time_query) || exit 1
+      record pivot pivot $rows $width $density $groups $ms
+
+      echo "select grp, $(seq_list 0 $(( width - 1 )) 'sum(decode(key, ' ', val))' ', ') from $fact group by grp;" > "$SQL"
+      ms=$(time_query) || exit 1
+      record pivot sum_decode $rows $width $density $groups $ms
+
+      # wide(grp, c0, ..., c<width-1>): pivoted fact, NULL where a group has no row of the key
+      vsql -c "drop table if exists $wide cascade;
+        create table $wide as
+        select grp, $(awk -v w=$width 'BEGIN { for (n = 0; n < w; n++) printf "%ssum(decode(key, %d, val)) as c%d", (n ? ", " : ""), n, n }') from $fact group by grp
+        order by grp segmented by hash(grp) all nodes;
+        select analyze_statistics('$wide');" -o /dev/null || exit 1
+
+      echo "select grp, unpivot($(seq_list 0 $(( width - 1 )) c '' ', ') using parameters measureNames = '$(seq_list 0 $(( width - 1 )) c '' ',')') over(partition by grp) from $wide;" > "$SQL"
+      ms=$(time_query) || exit 1
+      record unpivot unpivot $rows $width $density $groups $ms
+
+      echo "$(awk -v w=$width -v t=$wide 'BEGIN { for (n = 0; n < w; n++) printf "%sselect grp, '\''c%d'\'' as measureName, c%d as measureValue from %s\n", (n ? "union all " : ""), n, n, t }');" > "$SQL"
+      ms=$(time_query) || exit 1
+      record unpivot union_all $rows $width $density $groups $ms
+
+      if [ "$KEEP" != "1" ] ; then
+        vsql -c "drop table if exists $wide cascade; drop table if exists $fact cascade;" -o /dev/null
+      fi
+    done
+  done
+done
+
+vsql -c "copy $SCHEMA.results from local '$CSV' delimiter ',' abort on error; commit;" -o /dev/null || exit 1
@@ -0,0 +1,126 @@
+/* Copyright (c) DingQiang Liu(dingqiangliu@gmail.com), 2012 - 2017 -*- C++ -*- */
+/*
+ * Description: numeric words shared by pivot and unpivot, compared and parsed without converting to float
+ */
+
+#ifndef PIVOT_NUMERIC_H
+#define PIVOT_NUMERIC_H
+
+#include "Vertica.h"
+#include <string>
+#include <vector>
+#include <ctype.h>
+#include <stdlib.h>
+
+using namespace Vertica;
+
+
+// compare numeric words of same precision and scale, words[0] is the most significant one and signed
+inline int compareNumericWords(const uint64 *left, const uint64 *right, int wordsCount)
+{
+    if (left[0] != right[0])
+        return ((int64)left[0] < (int64)right[0])? -1 : 1;
+    for (int widx = 1; widx < wordsCount; widx++)
+    {
+        if (left[widx] != right[widx])
+            return (left[widx] < right[widx])? -1 : 1;
+    }
+    return 0;
+}
+
+// parse decimal text such as '-12345678901234567.89' or '1.5e3' into wordsCount numeric words scaled by 10^scale,
+// rounded toward negative infinity, and inexact is set if digits are dropped, so that the text is slightly larger than the words.
+// return false if text is not a number or its magnitude does not fit in precision digits.
+inline bool parseNumericWords(const std::string &text, int precision, int scale, uint64 *words, int wordsCount, bool &inexact)
+{
+    size_t pos = 0;
+    const bool isNegative = (pos < text.length() && text[pos] == '-');
+    if (pos < text.length() && (text[pos] == '-' || text[pos] == '+'))
+        pos++;
+
+    // digits of mantissa, and exponent of its last digit
+    std::string digits;
+    int exponent = 0;
+    bool hasPoint = false;
+    for (; pos < text.length() && (isdigit((unsigned char)text[pos]) || (text[pos] == '.' && !hasPoint)); pos++)
+    {
+        if (text[pos] == '.')
+            hasPoint = true;
+        else
+        {
+            digits += text[pos];
+            if (hasPoint)
+                exponent--;
+        }
+    }
+    if (digits.empty())
+        return false;
+    if (pos < text.length() && (text[pos] == 'e' || text[pos] == 'E'))
+    {
+        char* end = NULL;
+        const long shift = strtol(text.c_str() + pos + 1, &end, 10);
+        if (end == text.c_str() + pos + 1 || shift > 1000 || shift < -1000)
+            return false;
+        exponent += (int)shift;
+        pos = end - text.c_str();
+    }
+    if (pos != text.length())
+        return false;
+
+    // scale digits to 10^scale, dropping fractional digits beyond it
+    inexact = false;
+    const int shift = exponent + scale;
+    if (shift >= 0)
+        digits.append(shift, '0');
+    else
+    {
+        const size_t keep = ((size_t)(-shift) >= digits.length())? 0 : digits.length() + shift;
+        inexact = digits.find_first_not_of('0', keep) != std::string::npos;
+        digits.erase(keep);
+    }
+    size_t first = digits.find_first_not_of('0');
+    digits = (first == std::string::npos)? "" : digits.substr(first);
+    if (isNegative && inexact)
+    {
+        // floor of negative value is one more in magnitude
+        int didx = (int)digits.length() - 1;
+        for (; didx >= 0 && digits[didx] == '9'; didx--)
+            digits[didx] = '0';
+        if (didx >= 0)
+            digits[didx]++;
+        else
+            digits.insert(0, 1, '1');
+    }
+    if ((int)digits.length() > precision)
+        return false;
+
+    // magnitude as 32 bits limbs, most significant first
+    std::vector<uint32> limbs(2 * wordsCount, 0);
+    for (size_t didx = 0; didx < digits.length(); didx++)
+    {
+        uint64 carry = digits[didx] - '0';
+        for (int lidx = 2 * wordsCount - 1; lidx >= 0; lidx--)
+        {
+            const uint64 current = (uint64)limbs[lidx] * 10 + carry;
+            limbs[lidx] = (uint32)current;
+            carry = current >> 32;
+        }
+        if (carry != 0 || (limbs[0] & 0x80000000U) != 0)
+            return false;
+    }
+
+    uint64 carry = 1;
+    for (int widx = wordsCount - 1; widx >= 0; widx--)
+    {
+        uint64 word = ((uint64)limbs[2 * widx] << 32) | limbs[2 * widx + 1];
+        if (isNegative)
+        {
+            word = ~word + carry;
+            carry = (carry && word == 0)? 1 : 0;
+        }
+        words[widx] = word;
+    }
+    return true;
+}
+
+#endif // PIVOT_NUMERIC_H
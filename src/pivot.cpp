@@ -6,8 +6,18 @@
  */
 
 #include "Vertica.h"
+#include "profile.h"
+#include "numeric.h"
 #include <sstream>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <limits.h>
+#include <math.h>
 
 using namespace Vertica;
 using namespace std;
@@ -18,386 +28,3785 @@ using namespace std;
 #define methodSUM "SUM"
 #define methodFIRST "FIRST"
 #define methodLAST "LAST"
+#define methodCOUNT "COUNT"
+#define methodMIN "MIN"
+#define methodMAX "MAX"
+#define methodAVG "AVG"
 #define DEFAULT_method methodSUM
+// separator of multiple methods calculated in one pass, such as 'SUM,MAX,COUNT'
+#define METHODS_separator ','
+
+enum PivotMethod
+{
+    PIVOT_SUM,
+    PIVOT_FIRST,
+    PIVOT_LAST,
+    PIVOT_COUNT,
+    PIVOT_MIN,
+    PIVOT_MAX,
+    PIVOT_AVG
+};
+
+// kinds of measure values, decide how values are gathered into block buffer
+enum MeasureKind
+{
+    MEASURE_INT,
+    MEASURE_FLOAT,
+    MEASURE_NUMERIC,
+    // numeric of precision up to 18 fits in one word, accumulated as int64 scaled by 10^scale
+    MEASURE_SCALED,
+    // char/varchar/long varchar, accumulated row by row into string store while reader is still on the row
+    MEASURE_STRING
+};
+
+// kinds of measureName argument, decide how column of each row is looked up
+enum PivotKeyKind
+{
+    PIVOT_KEY_STRING,
+    PIVOT_KEY_INT,
+    PIVOT_KEY_DATE,
+    PIVOT_KEY_TIMESTAMP,
+    // several measureName arguments, column is mixed-radix index of their positions in each dimension
+    PIVOT_KEY_DIMENSIONS
+};
+
+// rows of each block accumulated at a time
+#define PIVOT_BLOCK_ROWS 1024
+// upper limit of groups kept before flush in hash mode
+#define DEFAULT_maxGroups 65536
+// memory of accumulators kept before flush in hash mode, decides default maxGroups for wide pivot
+#define PIVOT_GROUPS_MEMORY (64 * 1024 * 1024)
+// alignment of buffers in arena, size of cache line
+#define PIVOT_ARENA_ALIGN 64
+// default upper limit of memory of a function instance in MB, parameter maxMemory
+#define DEFAULT_maxMemory 1024
+// estimated bytes of a node of columnNames map with its key, which is only built in debug build
+#define PIVOT_MAP_NODE_BYTES 80
+// estimated bytes of a string group key, longer keys grow the key pool of hash mode beyond estimate
+#define PIVOT_STRING_KEY_BYTES 256
+
+inline int parsePivotMethod(const std::string &method)
+{
+    if (method == methodSUM)
+        return PIVOT_SUM;
+    else if (method == methodFIRST)
+        return PIVOT_FIRST;
+    else if (method == methodLAST)
+        return PIVOT_LAST;
+    else if (method == methodCOUNT)
+        return PIVOT_COUNT;
+    else if (method == methodMIN)
+        return PIVOT_MIN;
+    else if (method == methodMAX)
+        return PIVOT_MAX;
+    else if (method == methodAVG)
+        return PIVOT_AVG;
+    
+    vt_report_error(0, "Unknown method [%s], it should be one of %s, %s, %s, %s, %s, %s, %s!", method.c_str(), 
+                    methodSUM, methodFIRST, methodLAST, methodCOUNT, methodMIN, methodMAX, methodAVG);
+    return PIVOT_SUM;
+}
+
+// split method parameter such as 'SUM,MAX,COUNT' into method ids and upper case names
+inline void parsePivotMethods(const std::string &method, std::vector<int> &methodIds, std::vector<std::string> &methodNames)
+{
+    methodIds.clear();
+    methodNames.clear();
+
+    istringstream ss(method);
+    std::string token;
+    while (getline(ss, token, METHODS_separator))
+    {
+        size_t begin = token.find_first_not_of(" \t");
+        size_t end = token.find_last_not_of(" \t");
+        token = (begin == std::string::npos)? "" : token.substr(begin, end - begin + 1);
+        std::transform(token.begin(), token.end(), token.begin(), ::toupper);
+        methodIds.push_back(parsePivotMethod(token));
+        methodNames.push_back(token);
+    }
+
+    if (methodIds.empty())
+        vt_report_error(0, "Parameter [method] should not be empty!");
+}
+
+// name of output column for a columnsFilter value, measure midx and method, 
+// suffixed with "_midx" for 2nd and later measures, and with "_method" when more than one method are calculated.
+inline std::string pivotColumnName(const std::string &token, int midx, const std::string &methodName, bool withMethod)
+{
+    std::stringstream columnName;
+    columnName << token;
+    if (midx > 0) 
+        columnName << "_" << midx;
+    if (withMethod)
+    {
+        std::string suffix = methodName;
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+        columnName << "_" << suffix;
+    }
+    return columnName.str();
+}
+
+inline bool isPivotStringType(const VerticaType &measureType)
+{
+    return measureType.isChar() || measureType.isVarchar() || measureType.isLongVarchar();
+}
+
+// date/timestamp are int64 as int, but only ordered and not summed
+inline bool isPivotTemporalType(const VerticaType &measureType)
+{
+    return measureType.isDate() || measureType.isTimestamp() || measureType.isTimestampTz();
+}
+
+// int/float/numeric measures support all methods, date/timestamp/string measures only FIRST, LAST, MIN, MAX and COUNT.
+inline void checkPivotMeasureType(const VerticaType &measureType, int argument, const std::vector<int> &methodIds, const std::vector<std::string> &methodNames)
+{
+    if (measureType.isInt() || measureType.isFloat() || measureType.isNumeric())
+        return;
+    if (!isPivotTemporalType(measureType) && !isPivotStringType(measureType))
+        vt_report_error(0, "The [%d] argument should be int, float, numeric, date, timestamp or string, but type[%s] is provided!", argument, measureType.getTypeStr());
+
+    for(size_t kidx = 0; kidx < methodIds.size(); kidx++)
+    {
+        if (methodIds[kidx] == PIVOT_SUM || methodIds[kidx] == PIVOT_AVG)
+            vt_report_error(0, "Method [%s] is not supported on the [%d] argument of type[%s], only FIRST, LAST, MIN, MAX and COUNT are!", 
+                            methodNames[kidx].c_str(), argument, measureType.getTypeStr());
+    }
+}
+
+// PivotMultiPhase and outputFormat=packed keep aggregates in fixed words, so that they only support int/float/numeric measures.
+inline void checkPivotNumericMeasures(const SizedColumnTypes &input_types, int firstMeasure, int measureCount, const char *feature)
+{
+    for(int midx = 0; midx < measureCount; midx++)
+    {
+        const VerticaType &measureType = input_types.getColumnType(firstMeasure + midx);
+        if ( !measureType.isInt() && !measureType.isFloat() && !measureType.isNumeric() ) 
+            vt_report_error(0, "The [%d] argument should be int, float or numeric for %s, but type[%s] is provided!", firstMeasure + midx + 1, feature, measureType.getTypeStr());
+    }
+}
+
+// output type of method on measure type: COUNT is int, AVG is float, others are same as measure
+inline void addPivotOutputType(SizedColumnTypes &output_types, const VerticaType &measureType, int methodId, const std::string &columnName)
+{
+    if (methodId == PIVOT_COUNT)
+        output_types.addInt(columnName);
+    else if (methodId == PIVOT_AVG)
+        output_types.addFloat(columnName);
+    else if (measureType.isInt())
+        output_types.addInt(columnName);
+    else if (measureType.isFloat())
+        output_types.addFloat(columnName);
+    else if (measureType.isNumeric())
+        output_types.addNumeric(measureType.getNumericPrecision(), measureType.getNumericScale(), columnName);
+    else if (isPivotTemporalType(measureType) || isPivotStringType(measureType))
+        output_types.addArg(measureType, columnName);
+    else
+        vt_report_error(0, "Unkown type of 2 arguments: %s !", measureType.getTypeStr());
+}
+
+
+// default upper limit of columns generated from parameter columnsRange
+#define DEFAULT_maxColumns 1600
+// separator between bounds and optional step of a range, such as '2003-01-01..2003-03-21' or '1..100..5'
+#define RANGE_separator ".."
+// separator between lists of dimensions in columnsFilter and columnsRange, such as '2003-01-01,2003-01-02;web,store'
+#define DEFAULT_dimensionSeparator ";"
+// separator between values of dimensions in name of a column, such as '2003-01-01_web'
+#define DIMENSIONS_NAME_separator "_"
+// upper limit of dimensions, and of columns of their cross product
+#define PIVOT_MAX_DIMENSIONS 8
+#define PIVOT_MAX_DIMENSION_COLUMNS (1 << 20)
+// count of columns lists kept in columns cache
+#define COLUMNS_CACHE_SIZE 16
+// 10^n for n in 0..18, upper bound(exclusive) of magnitude of scaled numeric of precision n
+static const vint PIVOT_POWERS_OF_10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL, 
+    10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL, 100000000000000LL, 1000000000000000LL, 
+    10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+};
+// name of the extra last column of rows out of columnsFilter and columnsRange, with parameter otherColumn
+#define OTHER_COLUMN_name "__other"
+
+// days since 1970-01-01 of civil date, see http://howardhinnant.github.io/date_algorithms.html
+inline int64 daysFromCivil(int64 year, int64 month, int64 day)
+{
+    year -= (month <= 2)? 1 : 0;
+    const int64 era = (year >= 0 ? year : year - 399) / 400;
+    const int64 yoe = year - era * 400;
+    const int64 doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+inline void civilFromDays(int64 days, int64 &year, int64 &month, int64 &day)
+{
+    days += 719468;
+    const int64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64 doe = days - era * 146097;
+    const int64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64 mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp + (mp < 10 ? 3 : -9);
+    year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+// parse date in format YYYY-MM-DD as days since 1970-01-01
+inline bool parseIsoDate(const std::string &text, int64 &days)
+{
+    int year, month, day;
+    char tail;
+    if (text.length() != 10 || text[4] != '-' || text[7] != '-' 
+            || sscanf(text.c_str(), "%4d-%2d-%2d%c", &year, &month, &day, &tail) != 3)
+        return false;
+
+    days = daysFromCivil(year, month, day);
+    int64 checkYear, checkMonth, checkDay;
+    civilFromDays(days, checkYear, checkMonth, checkDay);
+    return (checkYear == year) && (checkMonth == month) && (checkDay == day);
+}
+
+inline std::string formatIsoDate(int64 days)
+{
+    int64 year, month, day;
+    civilFromDays(days, year, month, day);
+    char text[16];
+    snprintf(text, sizeof(text), "%04d-%02d-%02d", (int)year, (int)month, (int)day);
+    return text;
+}
+
+inline bool parseInteger(const std::string &text, int64 &value)
+{
+    if (text.empty())
+        return false;
+    char* end = NULL;
+    value = strtoll(text.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+// parse timestamp in format YYYY-MM-DD[ HH:MM:SS[.ffffff]] as microseconds since 1970-01-01 00:00:00
+inline bool parseIsoTimestamp(const std::string &text, int64 &microseconds)
+{
+    int64 days;
+    if (!parseIsoDate(text.substr(0, 10), days))
+        return false;
+
+    int hour = 0, minute = 0, second = 0;
+    int64 fraction = 0;
+    if (text.length() > 10)
+    {
+        char tail;
+        if (text.length() < 19 || (text[10] != ' ' && text[10] != 'T') || text[13] != ':' || text[16] != ':'
+                || sscanf(text.c_str() + 11, "%2d:%2d:%2d%c", &hour, &minute, &second, &tail) != 3 + (text.length() > 19 ? 1 : 0)
+                || hour > 23 || minute > 59 || second > 59)
+            return false;
+        if (text.length() > 19)
+        {
+            // fraction of 1 to 6 digits
+            if (text[19] != '.' || text.length() == 20 || text.length() > 26)
+                return false;
+            for (size_t pos = 20; pos < 26; pos++)
+            {
+                if (pos < text.length() && (text[pos] < '0' || text[pos] > '9'))
+                    return false;
+                fraction = fraction * 10 + ((pos < text.length())? text[pos] - '0' : 0);
+            }
+        }
+    }
+
+    microseconds = ((days * 24 + hour) * 60 + minute) * 60 + second;
+    microseconds = microseconds * 1000000 + fraction;
+    return true;
+}
+
+// expand range 'from..to[..step]' of integers or dates(YYYY-MM-DD, step in days) into columns
+inline void expandColumnsRange(const std::string &range, size_t maxColumns, std::vector<std::string> &columnKeys)
+{
+    std::vector<std::string> parts;
+    size_t begin = 0, end;
+    while ((end = range.find(RANGE_separator, begin)) != std::string::npos)
+    {
+        parts.push_back(range.substr(begin, end - begin));
+        begin = end + strlen(RANGE_separator);
+    }
+    parts.push_back(range.substr(begin));
+
+    int64 from, to, step = 1;
+    bool isDate = false;
+    if (parts.size() < 2 || parts.size() > 3 || (parts.size() == 3 && !parseInteger(parts[2], step)) || step <= 0)
+        vt_report_error(0, "Range [%s] should be 'from%sto[%sstep]' with positive step!", range.c_str(), RANGE_separator, RANGE_separator);
+    if (parseIsoDate(parts[0], from) && parseIsoDate(parts[1], to))
+        isDate = true;
+    else if (!parseInteger(parts[0], from) || !parseInteger(parts[1], to))
+        vt_report_error(0, "Bounds of range [%s] should be both integers or both dates in format YYYY-MM-DD!", range.c_str());
+    if (from > to)
+        vt_report_error(0, "Range [%s] should not start after its end!", range.c_str());
+
+    for (int64 value = from; value <= to; value += step)
+    {
+        if (columnKeys.size() >= maxColumns)
+            vt_report_error(0, "Columns with range [%s] are more than [%zu], please narrow it or increase parameter [maxColumns]!", range.c_str(), maxColumns);
+
+        if (isDate)
+            columnKeys.push_back(formatIsoDate(value));
+        else
+        {
+            std::stringstream key;
+            key << value;
+            columnKeys.push_back(key.str());
+        }
+
+        // stop before value + step passes to, so that it never overflows near INT64_MAX. note: to - value is unsigned, as it may not fit in int64
+        if ((uint64)to - (uint64)value < (uint64)step)
+            break;
+    }
+}
+
+// Process wide cache of columns lists, keyed by the text of parameters they are parsed from, shared by all sessions on this node. 
+// Planning and every instance of the same query on this node split the (up to 65000 bytes) columnsFilter only once.
+class PivotColumnsCache
+{
+private:
+    pthread_mutex_t mutex;
+    std::map<std::string, std::vector<std::string> > columnsLists;
+    std::vector<std::string> cachedKeys;
+
+public:
+    PivotColumnsCache()
+    {
+        pthread_mutex_init(&mutex, NULL);
+    }
+
+    ~PivotColumnsCache()
+    {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    bool get(const std::string &cacheKey, std::vector<std::string> &columnKeys)
+    {
+        pthread_mutex_lock(&mutex);
+        std::map<std::string, std::vector<std::string> >::iterator i = columnsLists.find(cacheKey);
+        bool found = (i != columnsLists.end());
+        if (found)
+            columnKeys = i->second;
+        pthread_mutex_unlock(&mutex);
+        return found;
+    }
+
+    void put(const std::string &cacheKey, const std::vector<std::string> &columnKeys)
+    {
+        pthread_mutex_lock(&mutex);
+        if (columnsLists.find(cacheKey) == columnsLists.end())
+        {
+            // evict the oldest one
+            if (cachedKeys.size() >= COLUMNS_CACHE_SIZE)
+            {
+                columnsLists.erase(cachedKeys.front());
+                cachedKeys.erase(cachedKeys.begin());
+            }
+            cachedKeys.push_back(cacheKey);
+        }
+        columnsLists[cacheKey] = columnKeys;
+        pthread_mutex_unlock(&mutex);
+    }
+
+    static PivotColumnsCache& instance()
+    {
+        static PivotColumnsCache cache;
+        return cache;
+    }
+};
+
+// get count of measureName arguments from parameter dimensions, default value is 1.
+inline int getPivotDimensions(ParamReader &paramReader)
+{
+    vint dimensions = 1;
+    if (paramReader.containsParameter("dimensions"))
+        dimensions = paramReader.getIntRef("dimensions");
+    if (dimensions < 1 || dimensions > PIVOT_MAX_DIMENSIONS)
+        vt_report_error(0, "Parameter [dimensions] should be between 1 and [%d], but [%lld] is provided!", PIVOT_MAX_DIMENSIONS, (long long)dimensions);
+    return (int)dimensions;
+}
+
+// split list of parameter into lists of dimensions by dimensionSeparator, a missing list is empty.
+// note: list of single dimension is never split, so that it's same as before dimensions.
+inline void splitPivotDimensions(const std::string &list, const std::string &dimensionSeparator, int dimensions, const char *name, std::vector<std::string> &lists)
+{
+    lists.assign(dimensions, "");
+    if (dimensions == 1)
+    {
+        lists[0] = list;
+        return;
+    }
+
+    size_t start = 0;
+    for (int didx = 0; didx < dimensions && start <= list.length(); didx++)
+    {
+        size_t end = list.find(dimensionSeparator, start);
+        if (end == std::string::npos)
+            end = list.length();
+        else if (didx == dimensions - 1)
+            vt_report_error(0, "Parameter [%s] has more than [%d] lists of parameter [dimensions]!", name, dimensions);
+        lists[didx] = list.substr(start, end - start);
+        start = end + dimensionSeparator.length();
+    }
+}
+
+// values of columnsFilter split by separator, followed by values generated from columnsRange, no more than maxColumns in total.
+// note: columnsFilter alone is only limited by an explicit maxColumns, so that long lists work as before columnsRange.
+inline void expandPivotColumnKeys(const std::string &columnsFilter, const std::string &columnsRange, char delim, size_t maxColumns, bool limitFilter, std::vector<std::string> &columnKeys)
+{
+    columnKeys.clear();
+    std::string token;
+    istringstream ss(columnsFilter);
+    while (getline(ss, token, delim))
+        columnKeys.push_back(token);
+    if (limitFilter && columnKeys.size() > maxColumns)
+        vt_report_error(0, "Parameter [columnsFilter] has more than [%zu] columns, please increase parameter [maxColumns]!", maxColumns);
+
+    // note: ranges are appended after values of columnsFilter, so that their limit counts all columns.
+    istringstream ssRange(columnsRange);
+    while (getline(ssRange, token, delim))
+        expandColumnsRange(token, maxColumns, columnKeys);
+}
+
+// get values of each dimension from parameters: for dimension d, the d-th list of columnsFilter followed by the d-th list of columnsRange, 
+// at least one of columnsFilter and columnsRange is required, and each dimension should have a value.
+inline void getPivotDimensionKeys(ParamReader &paramReader, std::vector<std::vector<std::string> > &dimensionKeys)
+{
+    std::string separator = DEFAULT_separator;
+    if (paramReader.containsParameter("separator"))
+        separator = paramReader.getStringRef("separator").str();
+    if (separator.empty())
+        vt_report_error(0, "Parameter [separator] should not be empty!");
+    std::string columnsFilter = "";
+    if (paramReader.containsParameter("columnsFilter"))
+        columnsFilter = paramReader.getStringRef("columnsFilter").str();
+    std::string columnsRange = "";
+    if (paramReader.containsParameter("columnsRange"))
+        columnsRange = paramReader.getStringRef("columnsRange").str();
+    if (!paramReader.containsParameter("columnsFilter") && !paramReader.containsParameter("columnsRange"))
+        vt_report_error(0, "Function need at least parameter [columnsFilter] or [columnsRange]!");
+    vint maxColumns = DEFAULT_maxColumns;
+    if (paramReader.containsParameter("maxColumns"))
+        maxColumns = paramReader.getIntRef("maxColumns");
+    if (maxColumns <= 0)
+        vt_report_error(0, "Parameter [maxColumns] should be positive, but [%lld] is provided!", (long long)maxColumns);
+    const int dimensions = getPivotDimensions(paramReader);
+    std::string dimensionSeparator = DEFAULT_dimensionSeparator;
+    if (paramReader.containsParameter("dimensionSeparator"))
+        dimensionSeparator = paramReader.getStringRef("dimensionSeparator").str();
+    if (dimensions > 1 && (dimensionSeparator.empty() || dimensionSeparator == separator))
+        vt_report_error(0, "Parameter [dimensionSeparator] should not be empty or same as parameter [separator]!");
+
+    std::vector<std::string> filters, ranges;
+    splitPivotDimensions(columnsFilter, dimensionSeparator, dimensions, "columnsFilter", filters);
+    splitPivotDimensions(columnsRange, dimensionSeparator, dimensions, "columnsRange", ranges);
+    dimensionKeys.resize(dimensions);
+    for (int didx = 0; didx < dimensions; didx++)
+    {
+        expandPivotColumnKeys(filters[didx], ranges[didx], separator.c_str()[0], maxColumns, paramReader.containsParameter("maxColumns"), dimensionKeys[didx]);
+        if (dimensions > 1 && dimensionKeys[didx].empty())
+            vt_report_error(0, "Dimension [%d] has no value in parameters [columnsFilter] and [columnsRange]!", didx + 1);
+    }
+}
+
+// get columns from parameters: values of the only dimension, or names of cross product of values of dimensions, 
+// such as '2003-01-01_web', in which the last dimension changes fastest.
+inline void getPivotColumnKeys(ParamReader &paramReader, std::vector<std::string> &columnKeys)
+{
+    std::stringstream cacheKey;
+    const char *names[] = {"separator", "maxColumns", "dimensions", "dimensionSeparator", "columnsRange", "columnsFilter"};
+    for (size_t nidx = 0; nidx < sizeof(names) / sizeof(names[0]); nidx++)
+    {
+        if (!paramReader.containsParameter(names[nidx]))
+            cacheKey << '\1';
+        else if (nidx == 1 || nidx == 2)
+            cacheKey << paramReader.getIntRef(names[nidx]);
+        else
+            cacheKey << paramReader.getStringRef(names[nidx]).str();
+        cacheKey << '\0';
+    }
+    if (PivotColumnsCache::instance().get(cacheKey.str(), columnKeys))
+        return;
+
+    std::vector<std::vector<std::string> > dimensionKeys;
+    getPivotDimensionKeys(paramReader, dimensionKeys);
+    if (dimensionKeys.size() == 1)
+        columnKeys.swap(dimensionKeys[0]);
+    else
+    {
+        size_t count = 1;
+        for (size_t didx = 0; didx < dimensionKeys.size(); didx++)
+        {
+            count *= dimensionKeys[didx].size();
+            if (count > PIVOT_MAX_DIMENSION_COLUMNS)
+                vt_report_error(0, "Dimensions generate more than [%d] columns, please reduce their values!", PIVOT_MAX_DIMENSION_COLUMNS);
+        }
+        columnKeys.assign(1, "");
+        for (size_t didx = 0; didx < dimensionKeys.size(); didx++)
+        {
+            std::vector<std::string> product;
+            product.reserve(columnKeys.size() * dimensionKeys[didx].size());
+            for (size_t cidx = 0; cidx < columnKeys.size(); cidx++)
+            {
+                for (size_t vidx = 0; vidx < dimensionKeys[didx].size(); vidx++)
+                    product.push_back((didx == 0)? dimensionKeys[didx][vidx] : columnKeys[cidx] + DIMENSIONS_NAME_separator + dimensionKeys[didx][vidx]);
+            }
+            columnKeys.swap(product);
+        }
+    }
+
+    PivotColumnsCache::instance().put(cacheKey.str(), columnKeys);
+}
+
+// get parameter otherColumn, return true if rows out of columns are accumulated into an extra last column "__other"
+inline bool getPivotOtherColumn(ParamReader &paramReader)
+{
+    return paramReader.containsParameter("otherColumn") && paramReader.getBoolRef("otherColumn") == vbool_true;
+}
+
+// Hash index from columnsFilter values to column positions, compiled once in setup.
+// Open addressing with linear probing over a power-of-two table kept at most half full, and all key bytes are
+// copied into one contiguous pool, so looking up the VString of each row neither allocates nor walks a tree.
+class ColumnIndex
+{
+private:
+    struct Slot
+    {
+        uint64 hash;
+        uint32 keyOffset;
+        uint32 keyLength;
+        int column;     // -1 means empty slot
+    };
+
+    Slot* slots;
+    uint64 mask;
+    char* keyPool;
+    size_t keyPoolSize;
+
+public:
+    static inline uint64 hashBytes(const char* key, size_t length)
+    {
+        uint64 h = 0x9E3779B97F4A7C15ULL ^ length;
+        uint64 word;
+        while (length >= sizeof(word))
+        {
+            memcpy(&word, key, sizeof(word));
+            h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 32;
+            key += sizeof(word);
+            length -= sizeof(word);
+        }
+        if (length > 0)
+        {
+            word = 0;
+            memcpy(&word, key, length);
+            h = (h ^ word) * 0xC4CEB9FE1A85EC53ULL;
+        }
+        return h ^ (h >> 29);
+    }
+
+    ColumnIndex(): slots(NULL), mask(0), keyPool(NULL), keyPoolSize(0)
+    {
+    }
+
+    // note: like std::map assignment, a duplicated key keeps the last column position.
+    void build(const std::vector<std::string> &keys)
+    {
+        clear();
+
+        size_t tableSize = 4;
+        while (tableSize < keys.size() * 2)
+            tableSize <<= 1;
+        mask = tableSize - 1;
+        slots = new Slot[tableSize];
+        for (size_t sidx = 0; sidx < tableSize; sidx++)
+            slots[sidx].column = -1;
+
+        size_t poolSize = 0;
+        for (size_t idx = 0; idx < keys.size(); idx++)
+            poolSize += keys[idx].length();
+        keyPool = new char[poolSize + 1];
+        keyPoolSize = poolSize + 1;
+
+        uint32 keyOffset = 0;
+        for (size_t idx = 0; idx < keys.size(); idx++)
+        {
+            const std::string &key = keys[idx];
+            uint64 h = hashBytes(key.data(), key.length());
+            uint64 sidx = h & mask;
+            while (slots[sidx].column >= 0)
+            {
+                if (slots[sidx].hash == h && slots[sidx].keyLength == key.length() 
+                        && memcmp(keyPool + slots[sidx].keyOffset, key.data(), key.length()) == 0)
+                    break;
+                sidx = (sidx + 1) & mask;
+            }
+
+            if (slots[sidx].column < 0)
+            {
+                memcpy(keyPool + keyOffset, key.data(), key.length());
+                slots[sidx].hash = h;
+                slots[sidx].keyOffset = keyOffset;
+                slots[sidx].keyLength = key.length();
+                keyOffset += key.length();
+            }
+            slots[sidx].column = idx;
+        }
+    }
+
+    void clear()
+    {
+        if (slots != NULL)
+        {
+            delete[] slots;
+            slots = NULL;
+        }
+        if (keyPool != NULL)
+        {
+            delete[] keyPool;
+            keyPool = NULL;
+        }
+        keyPoolSize = 0;
+        mask = 0;
+    }
+
+    size_t memoryBytes() const
+    {
+        return ((slots != NULL)? (mask + 1) * sizeof(Slot) : 0) + keyPoolSize;
+    }
+
+    // return column position of key, or -1 if key is not in columnsFilter
+    inline int find(const char* key, size_t length) const
+    {
+        uint64 h = hashBytes(key, length);
+        for (uint64 sidx = h & mask; slots[sidx].column >= 0; sidx = (sidx + 1) & mask)
+        {
+            const Slot &slot = slots[sidx];
+            if (slot.hash == h && slot.keyLength == length && memcmp(keyPool + slot.keyOffset, key, length) == 0)
+                return slot.column;
+        }
+        return -1;
+    }
+};
+
+
+// kind of measureName argument, int/date/timestamp are looked up natively without casting to string
+inline bool getPivotKeyKind(const VerticaType &keyType, int &keyKind)
+{
+    if (keyType.isStringType())
+        keyKind = PIVOT_KEY_STRING;
+    else if (keyType.isInt())
+        keyKind = PIVOT_KEY_INT;
+    else if (keyType.isDate())
+        keyKind = PIVOT_KEY_DATE;
+    else if (keyType.isTimestamp())
+        keyKind = PIVOT_KEY_TIMESTAMP;
+    else
+        return false;
+    return true;
+}
+
+// parse columns into native values of key kind, date as days and timestamp as microseconds since 2000-01-01, same as Vertica.
+inline void getPivotNativeKeys(int keyKind, const std::vector<std::string> &columnKeys, std::vector<int64> &nativeKeys)
+{
+    const int64 epochDays = daysFromCivil(2000, 1, 1);
+    nativeKeys.resize(columnKeys.size());
+    for (size_t idx = 0; idx < columnKeys.size(); idx++)
+    {
+        bool parsed = false;
+        if (keyKind == PIVOT_KEY_INT)
+            parsed = parseInteger(columnKeys[idx], nativeKeys[idx]) && nativeKeys[idx] != vint_null;
+        else if (keyKind == PIVOT_KEY_DATE)
+        {
+            parsed = parseIsoDate(columnKeys[idx], nativeKeys[idx]);
+            nativeKeys[idx] -= epochDays;
+        }
+        else if (keyKind == PIVOT_KEY_TIMESTAMP)
+        {
+            parsed = parseIsoTimestamp(columnKeys[idx], nativeKeys[idx]);
+            nativeKeys[idx] -= epochDays * 24 * 3600 * 1000000;
+        }
+
+        if (!parsed)
+            vt_report_error(0, "Column [%s] should be %s as measureName argument!", columnKeys[idx].c_str(), 
+                            (keyKind == PIVOT_KEY_INT)? "integer" : ((keyKind == PIVOT_KEY_DATE)? "date in format YYYY-MM-DD" : "timestamp in format YYYY-MM-DD[ HH:MM:SS[.ffffff]]"));
+    }
+}
+
+// Index from native int/date/timestamp keys of columns to column positions, built once in setup.
+// Dense keys, such as consecutive dates or small ids, are looked up by key - minKey in an array, 
+// and sparse ones by open addressing over a power-of-two table kept at most half full.
+class NativeColumnIndex
+{
+private:
+    struct Slot
+    {
+        int64 key;
+        int column;     // -1 means empty slot
+    };
+
+    int64 minKey;
+    uint64 denseSize;
+    int* dense;
+    Slot* slots;
+    uint64 mask;
+
+    static inline uint64 hashKey(int64 key)
+    {
+        uint64 h = (uint64)key * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+
+public:
+    NativeColumnIndex(): minKey(0), denseSize(0), dense(NULL), slots(NULL), mask(0)
+    {
+    }
+
+    // note: like ColumnIndex, a duplicated key keeps the last column position.
+    void build(const std::vector<int64> &keys)
+    {
+        clear();
+        if (keys.empty())
+        {
+            dense = new int[1];
+            return;
+        }
+
+        int64 maxKey = keys[0];
+        minKey = keys[0];
+        for (size_t idx = 1; idx < keys.size(); idx++)
+        {
+            minKey = std::min(minKey, keys[idx]);
+            maxKey = std::max(maxKey, keys[idx]);
+        }
+
+        // dense when array is at most 4 times of keys, so that holes cost less memory than hash slots would
+        const uint64 range = (uint64)maxKey - (uint64)minKey;
+        if (range < 4 * keys.size() + 64)
+        {
+            denseSize = range + 1;
+            dense = new int[denseSize];
+            for (uint64 offset = 0; offset < denseSize; offset++)
+                dense[offset] = -1;
+            for (size_t idx = 0; idx < keys.size(); idx++)
+                dense[(uint64)keys[idx] - (uint64)minKey] = idx;
+            return;
+        }
+
+        size_t tableSize = 4;
+        while (tableSize < keys.size() * 2)
+            tableSize <<= 1;
+        mask = tableSize - 1;
+        slots = new Slot[tableSize];
+        for (size_t sidx = 0; sidx < tableSize; sidx++)
+            slots[sidx].column = -1;
+        for (size_t idx = 0; idx < keys.size(); idx++)
+        {
+            uint64 sidx = hashKey(keys[idx]) & mask;
+            while (slots[sidx].column >= 0 && slots[sidx].key != keys[idx])
+                sidx = (sidx + 1) & mask;
+            slots[sidx].key = keys[idx];
+            slots[sidx].column = idx;
+        }
+    }
+
+    void clear()
+    {
+        if (dense != NULL)
+        {
+            delete[] dense;
+            dense = NULL;
+        }
+        if (slots != NULL)
+        {
+            delete[] slots;
+            slots = NULL;
+        }
+        denseSize = 0;
+        mask = 0;
+    }
+
+    size_t memoryBytes() const
+    {
+        return ((dense != NULL)? std::max(denseSize, (uint64)1) * sizeof(int) : 0) + ((slots != NULL)? (mask + 1) * sizeof(Slot) : 0);
+    }
+
+    // return column position of key, or -1 if key is not in columns.
+    // note: NULL is the minimum int64, its offset to any other minKey is out of dense array, and it is never a key of slots.
+    inline int find(int64 key) const
+    {
+        if (dense != NULL)
+        {
+            const uint64 offset = (uint64)key - (uint64)minKey;
+            return (offset < denseSize)? dense[offset] : -1;
+        }
+
+        for (uint64 sidx = hashKey(key) & mask; slots[sidx].column >= 0; sidx = (sidx + 1) & mask)
+        {
+            if (slots[sidx].key == key)
+                return slots[sidx].column;
+        }
+        return -1;
+    }
+};
+
+// Bytes of group key columns, so that a group is hashed and compared as one byte string, 
+// and its values are written back to output columns when the row of the group is flushed.
+// note: int/date/time/timestamp/interval and float take 8 bytes, bool 1 byte, numeric its words, 
+// and string a NULL flag byte and 4 bytes length followed by its data.
+class GroupKeyCodec
+{
+private:
+    enum KeyKind
+    {
+        KEY_INT,
+        KEY_FLOAT,
+        KEY_BOOL,
+        KEY_NUMERIC,
+        KEY_STRING
+    };
+
+    std::vector<size_t> keyColumns;
+    std::vector<int> keyKinds;
+    std::vector<int> keyWordsCounts;
+    size_t keyBytes;
+
+public:
+    GroupKeyCodec(): keyBytes(0)
+    {
+    }
+
+    static bool isSupported(const VerticaType &keyType)
+    {
+        return keyType.isInt() || keyType.isDate() || keyType.isTime() || keyType.isTimestamp() || keyType.isTimestampTz() 
+            || keyType.isInterval() || keyType.isFloat() || keyType.isBool() || keyType.isNumeric() || keyType.isStringType();
+    }
+
+    // key is values of input columns in columns
+    void init(const SizedColumnTypes &input_types, const std::vector<size_t> &columns)
+    {
+        keyColumns = columns;
+        keyKinds.clear();
+        keyWordsCounts.clear();
+        keyBytes = 0;
+        for(size_t kidx = 0; kidx < keyColumns.size(); kidx++)
+        {
+            const VerticaType &keyType = input_types.getColumnType(keyColumns[kidx]);
+            if (keyType.isFloat())
+                keyKinds.push_back(KEY_FLOAT);
+            else if (keyType.isBool())
+                keyKinds.push_back(KEY_BOOL);
+            else if (keyType.isNumeric())
+                keyKinds.push_back(KEY_NUMERIC);
+            else if (keyType.isStringType())
+                keyKinds.push_back(KEY_STRING);
+            else
+                keyKinds.push_back(KEY_INT);
+            keyWordsCounts.push_back(keyType.isNumeric()? (keyType.getNumericPrecision()+19)/19 : 1);
+            if (keyKinds.back() == KEY_STRING)
+                keyBytes += 1 + sizeof(uint32) + std::min((size_t)keyType.getStringLength(), (size_t)PIVOT_STRING_KEY_BYTES);
+            else if (keyKinds.back() == KEY_BOOL)
+                keyBytes += sizeof(vbool);
+            else
+                keyBytes += keyWordsCounts.back() * sizeof(uint64);
+        }
+    }
+
+    int size() const
+    {
+        return keyKinds.size();
+    }
+
+    // estimated bytes of an encoded key
+    size_t estimatedKeyBytes() const
+    {
+        return keyBytes;
+    }
+
+    // encode key columns of current row to key
+    template <class Reader>
+    void encode(Reader &input_reader, std::string &key) const
+    {
+        key.clear();
+        for(size_t kidx = 0; kidx < keyKinds.size(); kidx++)
+        {
+            switch (keyKinds[kidx])
+            {
+            case KEY_INT:
+                key.append((const char*)&input_reader.getIntRef(keyColumns[kidx]), sizeof(vint));
+                break;
+            case KEY_FLOAT:
+            {
+                // note: 0.0 and -0.0 are same group
+                vfloat value = input_reader.getFloatRef(keyColumns[kidx]);
+                if (value == 0)
+                    value = 0;
+                key.append((const char*)&value, sizeof(vfloat));
+                break;
+            }
+            case KEY_BOOL:
+                key.append((const char*)&input_reader.getBoolRef(keyColumns[kidx]), sizeof(vbool));
+                break;
+            case KEY_NUMERIC:
+                key.append((const char*)input_reader.getNumericPtr(keyColumns[kidx])->words, keyWordsCounts[kidx] * sizeof(uint64));
+                break;
+            case KEY_STRING:
+            {
+                const VString &value = input_reader.getStringRef(keyColumns[kidx]);
+                uint32 length = value.length();
+                key.push_back(value.isNull()? 1 : 0);
+                key.append((const char*)&length, sizeof(length));
+                key.append(value.data(), length);
+                break;
+            }
+            }
+        }
+    }
+
+    // write values in key to output columns from outputBase
+    template <class Writer>
+    void decode(Writer &output_writer, int outputBase, const char *key) const
+    {
+        for(size_t kidx = 0; kidx < keyKinds.size(); kidx++)
+        {
+            switch (keyKinds[kidx])
+            {
+            case KEY_INT:
+            {
+                vint value;
+                memcpy(&value, key, sizeof(vint));
+                output_writer.setInt(outputBase + kidx, value);
+                key += sizeof(vint);
+                break;
+            }
+            case KEY_FLOAT:
+            {
+                vfloat value;
+                memcpy(&value, key, sizeof(vfloat));
+                output_writer.setFloat(outputBase + kidx, value);
+                key += sizeof(vfloat);
+                break;
+            }
+            case KEY_BOOL:
+            {
+                vbool value;
+                memcpy(&value, key, sizeof(vbool));
+                output_writer.setBool(outputBase + kidx, value);
+                key += sizeof(vbool);
+                break;
+            }
+            case KEY_NUMERIC:
+                memcpy(output_writer.getNumericRef(outputBase + kidx).words, key, keyWordsCounts[kidx] * sizeof(uint64));
+                key += keyWordsCounts[kidx] * sizeof(uint64);
+                break;
+            case KEY_STRING:
+            {
+                bool isNull = (key[0] != 0);
+                uint32 length;
+                memcpy(&length, key + 1, sizeof(length));
+                key += 1 + sizeof(length);
+                if (isNull)
+                    output_writer.getStringRef(outputBase + kidx).setNull();
+                else
+                    output_writer.getStringRef(outputBase + kidx).copy(key, length);
+                key += length;
+                break;
+            }
+            }
+        }
+    }
+};
+
+
+// Hash table from encoded group keys to group positions, filled while rows come and cleared after each flush.
+// Like ColumnIndex, it is open addressing with linear probing kept at most half full, with key bytes in one pool.
+class GroupIndex
+{
+private:
+    struct Slot
+    {
+        uint64 hash;
+        int group;      // -1 means empty slot
+    };
+
+    std::vector<Slot> slots;
+    uint64 mask;
+    std::vector<char> keyPool;
+    std::vector<size_t> keyOffsets;
+    std::vector<size_t> keyLengths;
+
+public:
+    GroupIndex(): mask(0)
+    {
+    }
+
+    // estimated bytes of a table of capacity groups, whose keys are keyBytes each
+    static size_t memoryBytes(int capacity, size_t keyBytes)
+    {
+        size_t tableSize = 4;
+        while (tableSize < (size_t)capacity * 2)
+            tableSize <<= 1;
+        return tableSize * sizeof(Slot) + (size_t)capacity * (2 * sizeof(size_t) + keyBytes);
+    }
+
+    void init(int capacity)
+    {
+        size_t tableSize = 4;
+        while (tableSize < (size_t)capacity * 2)
+            tableSize <<= 1;
+        mask = tableSize - 1;
+        slots.resize(tableSize);
+        keyOffsets.reserve(capacity);
+        keyLengths.reserve(capacity);
+        clear();
+    }
+
+    void clear()
+    {
+        for (size_t sidx = 0; sidx < slots.size(); sidx++)
+            slots[sidx].group = -1;
+        keyPool.clear();
+        keyOffsets.clear();
+        keyLengths.clear();
+    }
+
+    int size() const
+    {
+        return keyOffsets.size();
+    }
+
+    const char* key(int group) const
+    {
+        return &keyPool[0] + keyOffsets[group];
+    }
+
+    // return position of group, new group is appended if key is not found.
+    // note: caller should flush and clear before size() reaches capacity.
+    inline int findOrInsert(const char* key, size_t length)
+    {
+        uint64 h = ColumnIndex::hashBytes(key, length);
+        uint64 sidx = h & mask;
+        for (; slots[sidx].group >= 0; sidx = (sidx + 1) & mask)
+        {
+            const Slot &slot = slots[sidx];
+            if (slot.hash == h && keyLengths[slot.group] == length && memcmp(&keyPool[0] + keyOffsets[slot.group], key, length) == 0)
+                return slot.group;
+        }
+
+        int group = keyOffsets.size();
+        slots[sidx].hash = h;
+        slots[sidx].group = group;
+        keyOffsets.push_back(keyPool.size());
+        keyLengths.push_back(length);
+        keyPool.insert(keyPool.end(), key, key + length);
+        return group;
+    }
+};
+
+
+// get count of leading group key arguments of hash mode from parameter groupKeys, 0 means partition mode.
+inline int getPivotGroupKeys(ParamReader &paramReader, const SizedColumnTypes &input_types)
+{
+    vint keyCount = 0;
+    if (paramReader.containsParameter("groupKeys"))
+        keyCount = paramReader.getIntRef("groupKeys");
+    if (keyCount < 0 || keyCount + 2 > (vint)input_types.getColumnCount())
+        vt_report_error(0, "Parameter [groupKeys] should be between 0 and count of arguments minus 2, but [%lld] is provided!", (long long)keyCount);
+
+    for(int kidx = 0; kidx < keyCount; kidx++)
+    {
+        if (!GroupKeyCodec::isSupported(input_types.getColumnType(kidx)))
+            vt_report_error(0, "The [%d] argument is group key, but its type[%s] is not supported!", kidx + 1, input_types.getColumnType(kidx).getTypeStr());
+    }
+    return keyCount;
+}
+
+// get count of measureName arguments after group keys from parameter dimensions, and kind of each of them
+inline int getPivotDimensionArguments(ParamReader &paramReader, const SizedColumnTypes &input_types, int keyCount, std::vector<int> &keyKinds)
+{
+    const int dimensions = getPivotDimensions(paramReader);
+    if (keyCount + dimensions + 1 > (int)input_types.getColumnCount())
+        vt_report_error(0, "There should be [%d] group keys, [%d] measureName arguments and 1 or more measures, but [%zu] arguments are provided!", 
+                        keyCount, dimensions, input_types.getColumnCount());
+    keyKinds.resize(dimensions);
+    for(int didx = 0; didx < dimensions; didx++)
+    {
+        const VerticaType &keyType = input_types.getColumnType(keyCount + didx);
+        if ( ! getPivotKeyKind(keyType, keyKinds[didx]) )
+            vt_report_error(0, "The [%d] argument should be string, int, date or timestamp, but type[%s] is provided!", keyCount + didx + 1, keyType.getTypeStr());
+    }
+    return dimensions;
+}
+
+// partial aggregates of PivotMultiPhase are merged in any order, so that FIRST/LAST are not supported.
+inline void checkPivotPartialMethods(int keyCount, const std::vector<int> &methodIds)
+{
+    if (keyCount < 1)
+        vt_report_error(0, "PivotMultiPhase need parameter [groupKeys] 1 or more!");
+    for(size_t kidx = 0; kidx < methodIds.size(); kidx++)
+    {
+        if (methodIds[kidx] == PIVOT_FIRST || methodIds[kidx] == PIVOT_LAST)
+            vt_report_error(0, "PivotMultiPhase supports methods SUM, COUNT, MIN, MAX and AVG, FIRST/LAST need Pivot with ordered partition!");
+    }
+}
+
+
+// output formats: a column for each cell, or all cells of a row packed in one varbinary column
+#define outputFormatCOLUMNS "COLUMNS"
+#define outputFormatPACKED "PACKED"
+// header of packed value: cellsCount and aggregateCount, followed by kind, words and scale of each aggregate
+#define PACKED_HEADER_BYTES 8
+#define PACKED_AGGREGATE_BYTES 6
+// packed value longer than this is long varbinary
+#define PACKED_MAX_VARBINARY 65000
+#define PACKED_MAX_LONG_VARBINARY 32000000
+// text of a cell extracted from packed value, wide enough for numeric of max precision 1024
+#define PIVOTCELL_LENGTH 1040
+// upper limit of digits and scale of numeric in packed value, and of its words, same as numeric of max precision
+#define PIVOTCELL_MAX_DIGITS 1024
+#define PIVOTCELL_MAX_WORDS (PIVOTCELL_MAX_DIGITS / 19 + 1)
+
+// kinds of values in packed value
+enum PackedKind
+{
+    PACKED_INT = 1,
+    PACKED_FLOAT,
+    PACKED_NUMERIC,
+    PACKED_COUNT
+};
+
+// get parameter topK, count of columns of largest 1st aggregate kept in each row, 0 means all columns.
+inline int getPivotTopK(ParamReader &paramReader)
+{
+    vint topK = 0;
+    if (paramReader.containsParameter("topK"))
+        topK = paramReader.getIntRef("topK");
+    if (topK < 0 || topK > PIVOT_MAX_DIMENSION_COLUMNS)
+        vt_report_error(0, "Parameter [topK] should be between 0 and [%d], but [%lld] is provided!", PIVOT_MAX_DIMENSION_COLUMNS, (long long)topK);
+    return (int)topK;
+}
+
+// columns set at most in a row: all columns, or top K columns and __other.
+inline int getPivotSetColumns(int columnsCount, int topK, bool otherColumn)
+{
+    const int rankedCount = otherColumn? columnsCount - 1 : columnsCount;
+    return (topK > 0 && topK < rankedCount)? topK + (otherColumn? 1 : 0) : columnsCount;
+}
+
+// get parameter outputFormat, return true if it is packed
+inline bool getPivotPackedOutput(ParamReader &paramReader)
+{
+    if (!paramReader.containsParameter("outputFormat"))
+        return false;
+
+    std::string outputFormat = paramReader.getStringRef("outputFormat").str();
+    std::transform(outputFormat.begin(), outputFormat.end(), outputFormat.begin(), ::toupper);
+    if (outputFormat == outputFormatPACKED)
+        return true;
+    else if (outputFormat != outputFormatCOLUMNS)
+        vt_report_error(0, "Parameter [outputFormat] should be %s or %s, but [%s] is provided!", outputFormatCOLUMNS, outputFormatPACKED, outputFormat.c_str());
+    return false;
+}
+
+// Packed value of outputFormat=packed, all cells of a row in one varbinary instead of mostly NULL columns of a wide pivot.
+// layout in native byte order:
+//   header: uint32 cellsCount, uint32 aggregateCount, and for each aggregate uint8 kind, uint8 0, uint16 words, uint16 scale
+//   bitmap: (cellsCount + 7) / 8 bytes, bit of a cell is set if it is not NULL
+//   values: value of each set cell in order of cells, words * 8 bytes, and 8 bytes for int, float and count.
+// note: cell idx * aggregateCount + aidx is the position of the column in default output format, without group keys.
+class PivotPacked
+{
+public:
+    static int valueKind(const VerticaType &measureType, int methodId)
+    {
+        if (methodId == PIVOT_COUNT)
+            return PACKED_COUNT;
+        else if (methodId == PIVOT_AVG || measureType.isFloat())
+            return PACKED_FLOAT;
+        else if (measureType.isNumeric())
+            return PACKED_NUMERIC;
+        else
+            return PACKED_INT;
+    }
+
+    static int valueWords(const VerticaType &measureType, int methodId)
+    {
+        return (valueKind(measureType, methodId) == PACKED_NUMERIC)? measureType.getNumericPrecision() / 19 + 1 : 1;
+    }
+
+    // write header of aggregates of methods on each measure from input column firstMeasure into buffer, or just get its size if buffer is NULL.
+    // maxSize is size of packed value with all cells of setColumns columns set, setColumns is less than columnsCount with parameter topK.
+    static size_t writeHeader(char *buffer, const SizedColumnTypes &input_types, int firstMeasure, int measureCount, 
+                              const std::vector<int> &methodIds, int columnsCount, int setColumns, size_t &maxSize)
+    {
+        const uint32 aggregateCount = measureCount * methodIds.size();
+        const uint32 cellsCount = columnsCount * aggregateCount;
+        const size_t headerBytes = PACKED_HEADER_BYTES + PACKED_AGGREGATE_BYTES * aggregateCount;
+        if (buffer != NULL)
+        {
+            memcpy(buffer, &cellsCount, sizeof(uint32));
+            memcpy(buffer + sizeof(uint32), &aggregateCount, sizeof(uint32));
+        }
+
+        size_t rowValuesBytes = 0;
+        for(uint32 aidx = 0; aidx < aggregateCount; aidx++)
+        {
+            const VerticaType &measureType = input_types.getColumnType(firstMeasure + aidx / methodIds.size());
+            const int methodId = methodIds[aidx % methodIds.size()];
+            const uint16 words = valueWords(measureType, methodId);
+            const uint16 scale = (valueKind(measureType, methodId) == PACKED_NUMERIC)? measureType.getNumericScale() : 0;
+            rowValuesBytes += words * sizeof(uint64);
+            if (buffer != NULL)
+            {
+                char* aggregatePtr = buffer + PACKED_HEADER_BYTES + PACKED_AGGREGATE_BYTES * aidx;
+                aggregatePtr[0] = (char)valueKind(measureType, methodId);
+                aggregatePtr[1] = 0;
+                memcpy(aggregatePtr + 2, &words, sizeof(uint16));
+                memcpy(aggregatePtr + 4, &scale, sizeof(uint16));
+            }
+        }
+
+        maxSize = headerBytes + (cellsCount + 7) / 8 + rowValuesBytes * setColumns;
+        return headerBytes;
+    }
+
+    // decimal text of numeric words into text of textCapacity bytes, words[0] is the most significant one and signed.
+    // note: words and scale may come from a corrupted packed value, so each buffer is bounded here instead of trusting them.
+    static size_t formatNumeric(const uint64 *words, int wordsCount, int scale, char *text, size_t textCapacity)
+    {
+        if (wordsCount <= 0 || wordsCount > PIVOTCELL_MAX_WORDS || scale < 0 || scale > PIVOTCELL_MAX_DIGITS)
+            vt_report_error(0, "Numeric of [%d] words and scale [%d] in packed pivot value is corrupted!", wordsCount, scale);
+
+        // magnitude as 32 bits limbs, most significant first
+        uint32 limbs[2 * PIVOTCELL_MAX_WORDS];
+        const int limbsCount = 2 * wordsCount;
+        const bool isNegative = (int64)words[0] < 0;
+        uint64 carry = 1;
+        for(int widx = wordsCount - 1; widx >= 0; widx--)
+        {
+            uint64 word = words[widx];
+            if (isNegative)
+            {
+                word = ~word + carry;
+                carry = (carry && word == 0)? 1 : 0;
+            }
+            limbs[2 * widx] = (uint32)(word >> 32);
+            limbs[2 * widx + 1] = (uint32)word;
+        }
+
+        // digits in reverse order by repeated division by 10^9
+        char digits[PIVOTCELL_MAX_DIGITS + 9];
+        int digitsCount = 0;
+        bool isZero = false;
+        while (!isZero)
+        {
+            if (digitsCount > PIVOTCELL_MAX_DIGITS)
+                vt_report_error(0, "Numeric in packed pivot value has more than [%d] digits, it is corrupted!", PIVOTCELL_MAX_DIGITS);
+            uint64 remainder = 0;
+            isZero = true;
+            for(int lidx = 0; lidx < limbsCount; lidx++)
+            {
+                const uint64 current = (remainder << 32) | limbs[lidx];
+                limbs[lidx] = (uint32)(current / 1000000000);
+                remainder = current % 1000000000;
+                isZero = isZero && (limbs[lidx] == 0);
+            }
+            for(int didx = 0; didx < 9 && (!isZero || remainder > 0); didx++)
+            {
+                digits[digitsCount++] = '0' + (char)(remainder % 10);
+                remainder /= 10;
+            }
+        }
+        while (digitsCount <= scale)
+            digits[digitsCount++] = '0';
+        if ((size_t)digitsCount + 2 > textCapacity)
+            vt_report_error(0, "Numeric of [%d] digits in packed pivot value is longer than [%zu] bytes!", digitsCount, textCapacity);
+
+        size_t length = 0;
+        if (isNegative)
+            text[length++] = '-';
+        for(int didx = digitsCount - 1; didx >= 0; didx--)
+        {
+            text[length++] = digits[didx];
+            if (didx == scale && scale > 0)
+                text[length++] = '.';
+        }
+        return length;
+    }
+
+    // text of cell in packed value into text of textCapacity bytes, return false if cell is NULL
+    static bool formatCell(const char *packed, size_t packedLength, int64 cell, char *text, size_t textCapacity, size_t &textLength)
+    {
+        uint32 cellsCount, aggregateCount;
+        if (packedLength < PACKED_HEADER_BYTES)
+            vt_report_error(0, "Packed pivot value of [%zu] bytes is corrupted!", packedLength);
+        memcpy(&cellsCount, packed, sizeof(uint32));
+        memcpy(&aggregateCount, packed + sizeof(uint32), sizeof(uint32));
+        const size_t headerBytes = PACKED_HEADER_BYTES + PACKED_AGGREGATE_BYTES * (size_t)aggregateCount;
+        const size_t bitmapBytes = ((size_t)cellsCount + 7) / 8;
+        if (aggregateCount == 0 || packedLength < headerBytes + bitmapBytes)
+            vt_report_error(0, "Packed pivot value of [%zu] bytes is corrupted!", packedLength);
+        if (cell < 0 || cell >= (int64)cellsCount)
+            return false;
+
+        const unsigned char* bitmap = (const unsigned char*)packed + headerBytes;
+        const int aidx = cell % aggregateCount;
+        const char* aggregatePtr = packed + PACKED_HEADER_BYTES + PACKED_AGGREGATE_BYTES * aidx;
+        const int kind = aggregatePtr[0];
+        uint16 words, scale;
+        memcpy(&words, aggregatePtr + 2, sizeof(uint16));
+        memcpy(&scale, aggregatePtr + 4, sizeof(uint16));
+        if ( !((bitmap[cell >> 3] >> (cell & 7)) & 1) )
+        {
+            // note: COUNT of column without any non-NULL value is 0, not NULL.
+            if (kind != PACKED_COUNT)
+                return false;
+            textLength = snprintf(text, textCapacity, "0");
+            return true;
+        }
+
+        // offset of value is sum of sizes of set cells before it, 
+        // just count of set bits before it if all aggregates are of same size, such as without numeric of precision more than 18.
+        bool isUniform = true;
+        for(uint32 previousAidx = 0; previousAidx < aggregateCount && isUniform; previousAidx++)
+            isUniform = (memcmp(packed + PACKED_HEADER_BYTES + PACKED_AGGREGATE_BYTES * previousAidx + 2, &words, sizeof(uint16)) == 0);
+        size_t offset = headerBytes + bitmapBytes;
+        if (isUniform)
+        {
+            size_t setCount = 0;
+            for(int64 byte = 0; byte < (cell >> 3); byte++)
+                setCount += __builtin_popcount(bitmap[byte]);
+            setCount += __builtin_popcount(bitmap[cell >> 3] & ((1 << (cell & 7)) - 1));
+            offset += setCount * words * sizeof(uint64);
+        }
+        for(int64 previous = 0; previous < cell && !isUniform; previous++)
+        {
+            if ((bitmap[previous >> 3] >> (previous & 7)) & 1)
+            {
+                uint16 previousWords;
+                memcpy(&previousWords, packed + PACKED_HEADER_BYTES + PACKED_AGGREGATE_BYTES * (previous % aggregateCount) + 2, sizeof(uint16));
+                offset += previousWords * sizeof(uint64);
+            }
+        }
+        if (offset + words * sizeof(uint64) > packedLength || words == 0 || words > PIVOTCELL_MAX_WORDS 
+                || (kind == PACKED_NUMERIC && scale > PIVOTCELL_MAX_DIGITS))
+            vt_report_error(0, "Packed pivot value of [%zu] bytes is corrupted!", packedLength);
+
+        // note: FIRST/LAST set the cell on NULL value too, so NULL value is kept as it is in packed value.
+        uint64 leadingWord;
+        memcpy(&leadingWord, packed + offset, sizeof(uint64));
+        if (kind != PACKED_FLOAT && leadingWord == (uint64)vint_null)
+        {
+            bool isNull = true;
+            for(int widx = 1; widx < words && isNull; widx++)
+            {
+                uint64 word;
+                memcpy(&word, packed + offset + widx * sizeof(uint64), sizeof(uint64));
+                isNull = (word == 0);
+            }
+            if (isNull)
+                return false;
+        }
+
+        if (kind == PACKED_FLOAT)
+        {
+            vfloat value;
+            memcpy(&value, packed + offset, sizeof(vfloat));
+            if (vfloatIsNull(value))
+                return false;
+            // note: shortest text which is parsed back to same value
+            textLength = snprintf(text, textCapacity, "%.15g", value);
+            if (strtod(text, NULL) != value)
+                textLength = snprintf(text, textCapacity, "%.17g", value);
+        }
+        else if (kind == PACKED_NUMERIC)
+        {
+            uint64 valueWords[PIVOTCELL_MAX_WORDS];
+            memcpy(valueWords, packed + offset, words * sizeof(uint64));
+            textLength = formatNumeric(valueWords, words, scale, text, textCapacity);
+        }
+        else
+        {
+            vint value;
+            memcpy(&value, packed + offset, sizeof(vint));
+            textLength = snprintf(text, textCapacity, "%lld", (long long)value);
+        }
+        return true;
+    }
+};
+
+
+// accumulator of AVG: sum and count of non-NULL values
+// accumulator of FIRST/LAST/MIN/MAX on string, bytes are in PivotStringStore.
+// note: capacity is only valid while the cell is set, a cell set again after reset gets new bytes from store.
+#define PIVOT_STRING_NULL 0xFFFFFFFF
+struct PivotString
+{
+    char* data;
+    uint32 length;
+    uint32 capacity;
+};
+
+// chunk size of PivotStringStore
+#define PIVOT_STRING_CHUNK (256 * 1024)
+
+// Bump allocator of bytes of string accumulators. All values of a partition(or groups before a flush) are released at once by reset, 
+// and chunks are kept for next partition, so that neither partition nor value allocates or frees on heap once chunks are warm.
+class PivotStringStore
+{
+private:
+    std::vector<char*> chunks;
+    std::vector<size_t> chunkSizes;
+    size_t chunkIdx;
+    size_t used;
+
+public:
+    PivotStringStore(): chunkIdx(0), used(0)
+    {
+    }
+
+    char* alloc(size_t size)
+    {
+        while (chunkIdx < chunks.size() && used + size > chunkSizes[chunkIdx])
+        {
+            chunkIdx++;
+            used = 0;
+        }
+        if (chunkIdx == chunks.size())
+        {
+            chunkSizes.push_back(std::max((size_t)PIVOT_STRING_CHUNK, size));
+            chunks.push_back(new char[chunkSizes.back()]);
+            used = 0;
+        }
+
+        char* ptr = chunks[chunkIdx] + used;
+        used += size;
+        return ptr;
+    }
+
+    // copy value into string accumulator, reusing its bytes if it's set and large enough
+    inline void assign(PivotString &aggregate, bool isSet, const VString &value)
+    {
+        if (value.isNull())
+        {
+            aggregate.length = PIVOT_STRING_NULL;
+            if (!isSet)
+                aggregate.capacity = 0;
+            return;
+        }
+
+        const uint32 length = value.length();
+        if (!isSet || length > aggregate.capacity)
+        {
+            aggregate.data = alloc(length);
+            aggregate.capacity = length;
+        }
+        memcpy(aggregate.data, value.data(), length);
+        aggregate.length = length;
+    }
+
+    void reset()
+    {
+        chunkIdx = 0;
+        used = 0;
+    }
+
+    void clear()
+    {
+        for (size_t cidx = 0; cidx < chunks.size(); cidx++)
+            delete[] chunks[cidx];
+        chunks.clear();
+        chunkSizes.clear();
+        reset();
+    }
+};
+
+
+// carve count elements of T from arena at arenaUsed, or just count size when arena is not allocated yet
+template <typename T>
+inline T* carvePivotArena(char* arenaPtr, size_t &arenaUsed, size_t count)
+{
+    size_t size = (sizeof(T) * count + PIVOT_ARENA_ALIGN - 1) & ~((size_t)PIVOT_ARENA_ALIGN - 1);
+    T* ptr = (arenaPtr != NULL)? (T*)(arenaPtr + arenaUsed) : NULL;
+    arenaUsed += size;
+    return ptr;
+}
+
+// allocate arena of arenaSize bytes aligned to cache line by srvInterface.allocator, which frees it with the function instance
+inline char* allocPivotArena(ServerInterface &srvInterface, size_t arenaSize)
+{
+    char* rawArenaPtr = (char*)srvInterface.allocator->alloc(arenaSize + PIVOT_ARENA_ALIGN);
+    return rawArenaPtr + ((PIVOT_ARENA_ALIGN - ((size_t)rawArenaPtr % PIVOT_ARENA_ALIGN)) % PIVOT_ARENA_ALIGN);
+}
+
+// get parameter maxMemory in MB, default value is DEFAULT_maxMemory
+inline vint getPivotMaxMemory(ParamReader &paramReader)
+{
+    vint maxMemory = DEFAULT_maxMemory;
+    if (paramReader.containsParameter("maxMemory"))
+        maxMemory = paramReader.getIntRef("maxMemory");
+    if (maxMemory <= 0)
+        vt_report_error(0, "Parameter [maxMemory] should be positive MB, but [%lld] is provided!", (long long)maxMemory);
+    return maxMemory;
+}
+
+
+struct PivotAverage
+{
+    vfloat sum;
+    vint count;
+};
+
 
 class Pivot : public TransformFunction
 {
-private:
-    int measureCount;
-    // note: use VerticaType** except VerticaType*, because there is no default constructor of class VerticaType for convenient initializing array. 
-    VerticaType** measureTypePtrPtr;
-	int columnsCount;
-    std::map<std::string, int>* columnNames;
-    std::string method;
+    friend class PivotMerge;
+
+private:
+    typedef void (*AccumulateBlockFunc)(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates);
+    typedef void (*OutputFunc)(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                               int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride);
+    typedef void (Pivot::*ProcessRowsFunc)(PartitionReader &input_reader, PartitionWriter &output_writer);
+    typedef void (*AccumulateStringFunc)(PivotStringStore &stringStore, uint64 *columnSetBits, int idx, void *aggregates, const VString &value);
+    typedef void (*MergeFunc)(const VerticaType &measureType, const int *columns, int count, const uint64 *fromSetBits, const void *from, uint64 *columnSetBits, void *aggregates, int toColumn);
+
+    int measureCount;
+    // note: use VerticaType** except VerticaType*, because there is no default constructor of class VerticaType for convenient initializing array. 
+    VerticaType** measureTypePtrPtr;
+	int columnsCount;
+    // note: columnIndex is used on the hot path, columnNames map is kept as reference implementation to verify it in debug build.
+    ColumnIndex columnIndex;
+#ifdef PIVOT_DEBUG
+    std::map<std::string, int> columnNames;
+#endif
+    // int/date/timestamp measureName is looked up by its native value, so that it needs neither casting to string nor hashing bytes.
+    int keyKind;
+    NativeColumnIndex nativeColumnIndex;
+    // dimensions=N: measureName arguments are looked up in their own dimension, and column is mixed-radix index of their positions.
+    // note: the first dimension is the most significant, same as order of names of columns.
+    struct PivotDimension
+    {
+        int keyKind;
+        int size;
+        ColumnIndex columnIndex;
+        NativeColumnIndex nativeColumnIndex;
+    };
+    int dimensionsCount;
+    PivotDimension* dimensions;
+    // position of 1st measure argument, after group keys and measureName arguments
+    int measureBase;
+    // otherColumn: rows out of columns are accumulated into the last column "__other" instead of being skipped, -1 without it
+    int otherColumn;
+    // topK: only K columns of largest 1st aggregate are written in each row, and the others are folded into __other if it's required. 
+    // 0 means all columns.
+    int topK;
+    // loop of rows specialized for keyKind and mode, chosen once in setup
+    ProcessRowsFunc processRowsFunc;
+    std::string method;
+    std::vector<int> methodIds;
+    int methodsCount;
+    // each method on each measure is an aggregate, aggregate aidx is method methodIds[aidx % methodsCount] on measure aidx / methodsCount.
+    int aggregateCount;
+
+    // hash mode: leading keyCount arguments are group keys, and rows of many groups are aggregated in one call.
+    // with partialOutput, as 1st phase of PivotMultiPhase, partial aggregates of each column of each group are written instead of wide rows.
+    int keyCount;
+    bool partialOutput;
+    GroupKeyCodec groupKeyCodec;
+    GroupIndex groupIndex;
+    std::string groupKey;
+    // groups kept before flush, 1 in partition mode. accumulator of column idx of group g is cell g * columnsCount + idx.
+    int groupsCapacity;
+    int cellsCount;
+
+    // all following buffers are carved from one cache aligned arena allocated from srvInterface.allocator in setup, 
+    // so they are released with the function instance.
+    char* arenaPtr;
+    size_t arenaSize;
+    size_t arenaUsed;
+
+    // kinds of each measure [measureCount]
+    MeasureKind* measureKinds;
+    int* measureWordsCounts;
+
+    // kernels for each aggregate [aggregateCount]
+    AccumulateBlockFunc* accumulateFuncs;
+    OutputFunc* outputFuncs;
+    int* aggregateMeasures;
+    // kernels of aggregates on string measures, called for each row when values are gathered [aggregateCount]
+    AccumulateStringFunc* accumulateStringFuncs;
+    // bytes of string accumulators, reset with set bitmaps after each partition or flush
+    PivotStringStore stringStore;
+
+    // kernels merging accumulators of columns, such as folding columns out of topK into __other [aggregateCount], NULL for string aggregates
+    MergeFunc* mergeFuncs;
+
+    // block buffer: column index [PIVOT_BLOCK_ROWS], and vint/vfloat/numeric words [measureCount][PIVOT_BLOCK_ROWS * words]
+    int* blockColumns;
+    void** blockValuesPtrPtr;
+
+    // set bitmaps [aggregateCount][bitmapWordsCount], one bit for each cell.
+    // note: a set column holds the result, SUM/MIN/MAX/COUNT/AVG set it on first non-NULL value, FIRST/LAST on first value even NULL.
+    int bitmapWordsCount;
+    uint64* columnSetBits;
+
+    // columns touched by rows of current partition, as bitmap [bitmapWordsCount] and list [touchedCount], 
+    // so that resetting costs in proportion to distinct keys seen rather than columnsCount.
+    uint64* touchedBits;
+    int* touchedColumns;
+    int touchedCount;
+    // all columns [columnsCount], as touched columns of each group in hash mode
+    int* allColumns;
+    // topK: weight of each column [columnsCount] ranking it, and cells folded into __other [columnsCount], empty without topK
+    double* columnWeights;
+    int* foldCells;
+
+    // buffer for aggregates: vint/vfloat/numeric words/PivotAverage [aggregateCount][cellsCount * words]
+    void** aggregatePtrPtr;
+
+    // outputFormat=packed: all cells of a row are written into packedBuffer [packedMaxSize], whose header is written once in setup
+    bool packedOutput;
+    char* packedBuffer;
+    size_t packedHeaderBytes;
+    size_t packedMaxSize;
+
+    // counters and timers of hot path, logged in destroy with parameter profile=true
+    PivotProfile profile;
+    int numericAggregateCount;
+
+    static inline bool isColumnSet(const uint64 *columnSetBits, int idx)
+    {
+        return (columnSetBits[idx >> 6] >> (idx & 63)) & 1;
+    }
+
+    static inline void setColumn(uint64 *columnSetBits, int idx)
+    {
+        columnSetBits[idx >> 6] |= ((uint64)1) << (idx & 63);
+    }
+
+    static int measureWords(const VerticaType &measureType)
+    {
+        if (measureType.isNumeric())
+            return (measureType.getNumericPrecision()+19)/19;
+        else
+            return 1;
+    }
+
+    static int aggregateWords(const VerticaType &measureType, int methodId)
+    {
+        if (methodId == PIVOT_COUNT)
+            return 1;
+        else if (methodId == PIVOT_AVG)
+            return sizeof(PivotAverage) / sizeof(uint64);
+        else if (isPivotStringType(measureType))
+            return sizeof(PivotString) / sizeof(uint64);
+        else
+            return measureWords(measureType);
+    }
+
+    // carve count elements of T from arena, or just count size when arena is not allocated yet
+    template <typename T>
+    T* carveArena(size_t count)
+    {
+        return carvePivotArena<T>(arenaPtr, arenaUsed, count);
+    }
+
+    // layout of arena, called once to get size and once more to assign buffers
+    void layoutArena()
+    {
+        arenaUsed = 0;
+        measureKinds = carveArena<MeasureKind>(measureCount);
+        measureWordsCounts = carveArena<int>(measureCount);
+        accumulateFuncs = carveArena<AccumulateBlockFunc>(aggregateCount);
+        outputFuncs = carveArena<OutputFunc>(aggregateCount);
+        aggregateMeasures = carveArena<int>(aggregateCount);
+        accumulateStringFuncs = carveArena<AccumulateStringFunc>(aggregateCount);
+        mergeFuncs = carveArena<MergeFunc>(aggregateCount);
+        blockColumns = carveArena<int>(PIVOT_BLOCK_ROWS);
+        blockValuesPtrPtr = carveArena<void*>(measureCount);
+        aggregatePtrPtr = carveArena<void*>(aggregateCount);
+        columnSetBits = carveArena<uint64>(aggregateCount * bitmapWordsCount);
+        touchedBits = carveArena<uint64>((columnsCount + 63) / 64);
+        touchedColumns = carveArena<int>(columnsCount);
+        allColumns = carveArena<int>(columnsCount);
+        columnWeights = carveArena<double>((topK > 0)? columnsCount : 0);
+        foldCells = carveArena<int>((topK > 0)? columnsCount : 0);
+        packedBuffer = carveArena<char>(packedMaxSize);
+        for(int midx = 0; midx < measureCount; midx++)
+        {
+            uint64* blockValuesPtr = carveArena<uint64>(PIVOT_BLOCK_ROWS * measureWords(*measureTypePtrPtr[midx]));
+            if (arenaPtr != NULL)
+                blockValuesPtrPtr[midx] = (void *) blockValuesPtr;
+        }
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
+        {
+            uint64* aggregatePtr = carveArena<uint64>((size_t)cellsCount * aggregateWords(*measureTypePtrPtr[aidx / methodsCount], methodIds[aidx % methodsCount]));
+            if (arenaPtr != NULL)
+                aggregatePtrPtr[aidx] = (void *) aggregatePtr;
+        }
+    }
+
+public:
+    Pivot(bool partialOutput = false): measureCount(0), measureTypePtrPtr(NULL), columnsCount(0), keyKind(PIVOT_KEY_STRING), dimensionsCount(1), dimensions(NULL), measureBase(1), otherColumn(-1), topK(0), processRowsFunc(NULL), method(DEFAULT_method), methodsCount(0), aggregateCount(0), 
+        keyCount(0), partialOutput(partialOutput), groupsCapacity(1), cellsCount(0), arenaPtr(NULL), arenaSize(0), arenaUsed(0), measureKinds(NULL), measureWordsCounts(NULL), accumulateFuncs(NULL), outputFuncs(NULL), 
+        aggregateMeasures(NULL), accumulateStringFuncs(NULL), mergeFuncs(NULL), blockColumns(NULL), blockValuesPtrPtr(NULL), bitmapWordsCount(0), columnSetBits(NULL), 
+        touchedBits(NULL), touchedColumns(NULL), touchedCount(0), allColumns(NULL), columnWeights(NULL), foldCells(NULL), aggregatePtrPtr(NULL), 
+        packedOutput(false), packedBuffer(NULL), packedHeaderBytes(0), packedMaxSize(0), numericAggregateCount(0)
+    {
+    }
+
+    // parse arguments and parameters, and size all buffers without allocating them, 
+    // so that factory can declare memory of an instance before it's created, and setup can check it against maxMemory.
+    void configure(ServerInterface &srvInterface, const SizedColumnTypes &input_types)
+    {
+        ParamReader paramReader = srvInterface.getParamReader();
+
+        // check arguments
+        if ( input_types.getColumnCount() < 2 ) 
+            vt_report_error(0, "There should be 2 or more arguments, but [%zu] arguments are provided!", input_types.getColumnCount());
+        keyCount = getPivotGroupKeys(paramReader, input_types);
+        std::vector<int> keyKinds;
+        dimensionsCount = getPivotDimensionArguments(paramReader, input_types, keyCount, keyKinds);
+        measureBase = keyCount + dimensionsCount;
+        measureCount = input_types.getColumnCount() - measureBase;
+        keyKind = (dimensionsCount > 1)? (int)PIVOT_KEY_DIMENSIONS : keyKinds[0];
+
+        // get parameters
+        if (paramReader.containsParameter("method"))
+            method = paramReader.getStringRef("method").str();
+        std::vector<std::string> methodNames;
+        parsePivotMethods(method, methodIds, methodNames);
+        methodsCount = methodIds.size();
+        aggregateCount = measureCount * methodsCount;
+        if (partialOutput)
+            checkPivotPartialMethods(keyCount, methodIds);
+        if (paramReader.containsParameter("profile"))
+            profile.enabled = paramReader.getBoolRef("profile") == vbool_true;
+        packedOutput = !partialOutput && getPivotPackedOutput(paramReader);
+
+        // check measures before any allocation
+        for(int midx = 0; midx < measureCount; midx++)
+            checkPivotMeasureType(input_types.getColumnType(measureBase+midx), measureBase+midx+1, methodIds, methodNames);
+        if (partialOutput)
+            checkPivotNumericMeasures(input_types, measureBase, measureCount, "PivotMultiPhase");
+        else if (packedOutput)
+            checkPivotNumericMeasures(input_types, measureBase, measureCount, "outputFormat=packed");
+        // note: columns are ranked by 1st aggregate, and only aggregates with merge kernels can be folded into __other.
+        topK = partialOutput? 0 : getPivotTopK(paramReader);
+        for(int aidx = 0; aidx < aggregateCount && topK > 0; aidx++)
+        {
+            const int methodId = methodIds[aidx % methodsCount];
+            if (isPivotStringType(input_types.getColumnType(measureBase + aidx / methodsCount)) && methodId != PIVOT_COUNT 
+                && (aidx == 0 || getPivotOtherColumn(paramReader)))
+                vt_report_error(0, "Parameter [topK] can not %s method [%s] on string argument [%d]!", 
+                                (aidx == 0)? "rank columns by" : "fold into __other", methodNames[aidx % methodsCount].c_str(), measureBase + aidx / methodsCount + 1);
+        }
+
+        measureTypePtrPtr = new VerticaType*[measureCount];
+        for(int midx = 0; midx < measureCount; midx++)
+        {
+            measureTypePtrPtr[midx] = new VerticaType(VUnspecOID, 0);
+            (*measureTypePtrPtr[midx]) = input_types.getColumnType(measureBase+midx);
+        }
+
+        // get columns from columnsFilter and columnsRange
+        std::vector<std::string> columnKeys;
+        getPivotColumnKeys(paramReader, columnKeys);
+        columnsCount = columnKeys.size();
+
+#ifdef PIVOT_DEBUG
+        columnNames.clear();
+        for(int idx = 0; idx < columnsCount; idx++)
+            columnNames[columnKeys[idx]] = idx;
+#endif
+        if (keyKind == PIVOT_KEY_DIMENSIONS)
+        {
+            std::vector<std::vector<std::string> > dimensionKeys;
+            getPivotDimensionKeys(paramReader, dimensionKeys);
+            dimensions = new PivotDimension[dimensionsCount];
+            for(int didx = 0; didx < dimensionsCount; didx++)
+            {
+                dimensions[didx].keyKind = keyKinds[didx];
+                dimensions[didx].size = dimensionKeys[didx].size();
+                if (keyKinds[didx] == PIVOT_KEY_STRING)
+                    dimensions[didx].columnIndex.build(dimensionKeys[didx]);
+                else
+                {
+                    std::vector<int64> nativeKeys;
+                    getPivotNativeKeys(keyKinds[didx], dimensionKeys[didx], nativeKeys);
+                    dimensions[didx].nativeColumnIndex.build(nativeKeys);
+                }
+            }
+        }
+        else if (keyKind == PIVOT_KEY_STRING)
+            columnIndex.build(columnKeys);
+        else
+        {
+            // note: native keys are never looked up as strings, so that they need neither hashing nor memory of string index.
+            std::vector<int64> nativeKeys;
+            getPivotNativeKeys(keyKind, columnKeys, nativeKeys);
+            nativeColumnIndex.build(nativeKeys);
+        }
+        // note: __other is not in indexes, rows are mapped to it only when they are not found.
+        otherColumn = -1;
+        if (getPivotOtherColumn(paramReader))
+            otherColumn = columnsCount++;
+        if (getPivotSetColumns(columnsCount, topK, otherColumn >= 0) == columnsCount)
+            topK = 0;
+        chooseProcessRows();
+
+        // capacity of groups in hash mode, default one fits accumulators into PIVOT_GROUPS_MEMORY
+        groupsCapacity = 1;
+        if (keyCount > 0)
+        {
+            size_t groupBytes = columnsCount * aggregateCount / 8 + 1;
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                groupBytes += columnsCount * aggregateWords(*measureTypePtrPtr[aidx / methodsCount], methodIds[aidx % methodsCount]) * sizeof(uint64);
+            vint maxGroups = std::max((vint)1, std::min((vint)DEFAULT_maxGroups, (vint)(PIVOT_GROUPS_MEMORY / groupBytes)));
+            if (paramReader.containsParameter("maxGroups"))
+                maxGroups = paramReader.getIntRef("maxGroups");
+            if (maxGroups <= 0 || maxGroups > (vint)(INT_MAX / std::max(columnsCount, 1)))
+                vt_report_error(0, "Parameter [maxGroups] should be between 1 and [%d], but [%lld] is provided!", INT_MAX / std::max(columnsCount, 1), (long long)maxGroups);
+            groupsCapacity = maxGroups;
+            std::vector<size_t> keyColumns;
+            for(int kidx = 0; kidx < keyCount; kidx++)
+                keyColumns.push_back(kidx);
+            groupKeyCodec.init(input_types, keyColumns);
+        }
+        cellsCount = groupsCapacity * columnsCount;
+
+        // size buffer
+        bitmapWordsCount = (cellsCount + 63) / 64;
+        packedMaxSize = 0;
+        if (packedOutput)
+            packedHeaderBytes = PivotPacked::writeHeader(NULL, input_types, measureBase, measureCount, methodIds, columnsCount, 
+                                                         getPivotSetColumns(columnsCount, topK, otherColumn >= 0), packedMaxSize);
+        layoutArena();
+        arenaSize = arenaUsed;
+
+        // check memory budget before any large allocation
+        const vint maxMemory = getPivotMaxMemory(paramReader);
+        if (memoryBytes() > (size_t)maxMemory * 1024 * 1024)
+            vt_report_error(0, "Pivot needs [%zu]MB memory for [%d] columns of [%d] aggregates%s, more than [%lld]MB of parameter [maxMemory], please reduce columns, measures, methods or maxGroups!", 
+                            (memoryBytes() + 1024 * 1024 - 1) / (1024 * 1024), columnsCount, aggregateCount, 
+                            (keyCount > 0)? " in each group" : "", (long long)maxMemory);
+    }
+
+    // memory of an instance after configure: arena, indexes of columns and groups, and first chunk of strings.
+    // note: strings of FIRST/LAST/MIN/MAX on varchar measures grow beyond estimate with distinct values.
+    size_t memoryBytes() const
+    {
+        size_t bytes = arenaSize + PIVOT_ARENA_ALIGN + columnIndex.memoryBytes() + nativeColumnIndex.memoryBytes();
+#ifdef PIVOT_DEBUG
+        bytes += (size_t)columnsCount * PIVOT_MAP_NODE_BYTES;
+#endif
+        for(int didx = 0; dimensions != NULL && didx < dimensionsCount; didx++)
+            bytes += sizeof(PivotDimension) + dimensions[didx].columnIndex.memoryBytes() + dimensions[didx].nativeColumnIndex.memoryBytes();
+        if (keyCount > 0)
+            bytes += GroupIndex::memoryBytes(groupsCapacity, groupKeyCodec.estimatedKeyBytes());
+        for(int midx = 0; midx < measureCount; midx++)
+        {
+            if (isPivotStringType(*measureTypePtrPtr[midx]))
+            {
+                bytes += PIVOT_STRING_CHUNK;
+                break;
+            }
+        }
+        return bytes;
+    }
+
+	virtual void setup (ServerInterface &srvInterface, const SizedColumnTypes &input_types)
+    {
+        configure(srvInterface, input_types);
+
+        // allocate buffer
+        if (keyCount > 0)
+            groupIndex.init(groupsCapacity);
+        arenaPtr = allocPivotArena(srvInterface, arenaSize);
+        layoutArena();
+        memset(columnSetBits, 0, sizeof(uint64) * aggregateCount * bitmapWordsCount);
+        memset(touchedBits, 0, sizeof(uint64) * ((columnsCount + 63) / 64));
+        touchedCount = 0;
+        for(int idx = 0; idx < columnsCount; idx++)
+            allColumns[idx] = idx;
+        if (packedOutput)
+            PivotPacked::writeHeader(packedBuffer, input_types, measureBase, measureCount, methodIds, columnsCount, 
+                                     getPivotSetColumns(columnsCount, topK, otherColumn >= 0), packedMaxSize);
+
+        // choose kernels
+        for(int midx = 0; midx < measureCount; midx++)
+        {
+            const VerticaType &measureType = *measureTypePtrPtr[midx];
+            measureWordsCounts[midx] = measureWords(measureType);
+            if (measureType.isInt() || isPivotTemporalType(measureType))
+                measureKinds[midx] = MEASURE_INT;
+            else if (isPivotStringType(measureType))
+                measureKinds[midx] = MEASURE_STRING;
+            else if (measureType.isFloat())
+                measureKinds[midx] = MEASURE_FLOAT;
+            else if (measureWordsCounts[midx] == 1)
+                measureKinds[midx] = MEASURE_SCALED;
+            else
+                measureKinds[midx] = MEASURE_NUMERIC;
+        }
+        numericAggregateCount = 0;
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
+        {
+            chooseKernels(aidx);
+            if (measureKinds[aggregateMeasures[aidx]] == MEASURE_NUMERIC || measureKinds[aggregateMeasures[aidx]] == MEASURE_SCALED)
+                numericAggregateCount++;
+        }
+    }
+
+	virtual void destroy (ServerInterface &srvInterface, const SizedColumnTypes &input_types){
+        profile.log(srvInterface, partialOutput? "PivotMultiPhase" : "Pivot");
+        release();
+	}
+
+    // free everything allocated by configure and setup
+    void release()
+    {
+        // note: arena is freed by srvInterface.allocator with this function instance
+        arenaPtr = NULL;
+        arenaSize = 0;
+        arenaUsed = 0;
+
+        columnIndex.clear();
+        nativeColumnIndex.clear();
+        if (dimensions != NULL)
+        {
+            for(int didx = 0; didx < dimensionsCount; didx++)
+            {
+                dimensions[didx].columnIndex.clear();
+                dimensions[didx].nativeColumnIndex.clear();
+            }
+            delete[] dimensions;
+            dimensions = NULL;
+        }
+        groupIndex.clear();
+        stringStore.clear();
+
+#ifdef PIVOT_DEBUG
+        columnNames.clear();
+#endif
+
+        if( measureTypePtrPtr != NULL )
+        {
+            for(int midx = 0; midx < measureCount; midx++)
+                delete measureTypePtrPtr[midx];
+            
+            delete[] measureTypePtrPtr;
+            measureTypePtrPtr = NULL;
+        }
+    }
+
+    static inline bool isNullValue(const vint value)
+    {
+        return value == vint_null;
+    }
+
+    static inline bool isNullValue(const vfloat value)
+    {
+        return vfloatIsNull(value);
+    }
+
+    // SUM/FIRST/LAST/MIN/MAX on int or float value
+    template <int METHOD, typename T>
+    static inline void processValue(uint64 *columnSetBits, int idx, T &aggregate, const T value)
+    {
+        if ( METHOD == PIVOT_SUM ) 
+        {
+            if ( !isNullValue(value) ) 
+            {
+                if ( isColumnSet(columnSetBits, idx) )
+                    aggregate += value;
+                else
+                {
+                    aggregate = value;
+                    setColumn(columnSetBits, idx);
+                }
+            }
+        }
+        else if ( (METHOD == PIVOT_MIN) || (METHOD == PIVOT_MAX) ) 
+        {
+            if ( !isNullValue(value) && (!isColumnSet(columnSetBits, idx) || ((METHOD == PIVOT_MIN)? value < aggregate : value > aggregate)) ) 
+            {
+                aggregate = value;
+                setColumn(columnSetBits, idx);
+            }
+        }
+        else if ( (METHOD == PIVOT_LAST) || !isColumnSet(columnSetBits, idx) ) 
+        {
+            aggregate = value;
+            setColumn(columnSetBits, idx);
+        }
+    }
+
+    // SUM/FIRST/LAST/MIN/MAX on numeric value
+    template <int METHOD>
+    static inline void processValueNumeric(uint64 *columnSetBits, int idx, VNumeric &aggregate, const VNumeric *valuePtr, int wordsCount)
+    {
+        if ( METHOD == PIVOT_SUM ) 
+        {
+            if ( !valuePtr->isNull() ) 
+            {
+                if ( isColumnSet(columnSetBits, idx) )
+                    aggregate.accumulate(valuePtr);
+                else
+                {
+                    aggregate.copy(valuePtr);
+                    setColumn(columnSetBits, idx);
+                }
+            }
+        }
+        else if ( (METHOD == PIVOT_MIN) || (METHOD == PIVOT_MAX) ) 
+        {
+            if ( !valuePtr->isNull() && (!isColumnSet(columnSetBits, idx) 
+                    || ((METHOD == PIVOT_MIN)? compareNumericWords(valuePtr->words, aggregate.words, wordsCount) < 0 
+                                             : compareNumericWords(valuePtr->words, aggregate.words, wordsCount) > 0)) ) 
+            {
+                aggregate.copy(valuePtr);
+                setColumn(columnSetBits, idx);
+            }
+        }
+        else if ( (METHOD == PIVOT_LAST) || !isColumnSet(columnSetBits, idx) ) 
+        {
+            aggregate.copy(valuePtr);
+            setColumn(columnSetBits, idx);
+        }
+    }
+
+    // gather measure values of current row into slot row of block buffer valuesPtrPtr, whose columns are in columns
+    inline void gatherValues(PartitionReader &input_reader, void **valuesPtrPtr, const int *columns, int row)
+    {
+        for(int midx = 0; midx < measureCount; midx++)
+        {
+            switch (measureKinds[midx])
+            {
+            case MEASURE_INT:
+                ((vint*)valuesPtrPtr[midx])[row] = input_reader.getIntRef(measureBase + midx);
+                break;
+            case MEASURE_FLOAT:
+                ((vfloat*)valuesPtrPtr[midx])[row] = input_reader.getFloatRef(measureBase + midx);
+                break;
+            case MEASURE_NUMERIC:
+                memcpy((uint64*)valuesPtrPtr[midx] + row * measureWordsCounts[midx], 
+                        input_reader.getNumericPtr(measureBase + midx)->words, measureWordsCounts[midx] * sizeof(uint64));
+                break;
+            case MEASURE_SCALED:
+                // note: NULL of one word numeric is same bits as vint_null
+                ((vint*)valuesPtrPtr[midx])[row] = (vint)input_reader.getNumericPtr(measureBase + midx)->words[0];
+                break;
+            case MEASURE_STRING:
+            {
+                // note: bytes of string are only valid on current row, so it's accumulated now instead of with the block.
+                const VString &value = input_reader.getStringRef(measureBase + midx);
+                for(int aidx = midx * methodsCount; aidx < (midx + 1) * methodsCount; aidx++)
+                    accumulateStringFuncs[aidx](stringStore, columnSetBits + aidx * bitmapWordsCount, columns[row], aggregatePtrPtr[aidx], value);
+                break;
+            }
+            }
+        }
+    }
+
+    // kernels of each (measure type, method), chosen once per aggregate in setup, so that rows loop has no type or method branch.
+    // each kernel accumulates values of a whole block of rows, in rows order, into column columns[row].
+    template <int METHOD, typename T>
+    static void accumulateBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        const T* valuePtr = (const T*)values;
+        T* aggregatePtr = (T*)aggregates;
+        for(int row = 0; row < rows; row++)
+            processValue<METHOD, T>(columnSetBits, columns[row], aggregatePtr[columns[row]], valuePtr[row]);
+    }
+
+    template <int METHOD>
+    static void accumulateNumericBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        const int wordsCount = measureWords(measureType);
+        uint64* valueWordsPtr = (uint64*)values;
+        uint64* aggregateWordsPtr = (uint64*)aggregates;
+        for(int row = 0; row < rows; row++)
+        {
+            const VNumeric value(valueWordsPtr + row * wordsCount, measureType.getNumericPrecision(), measureType.getNumericScale());
+            VNumeric aggregate(aggregateWordsPtr + (size_t)columns[row] * wordsCount, measureType.getNumericPrecision(), measureType.getNumericScale());
+            processValueNumeric<METHOD>(columnSetBits, columns[row], aggregate, &value, wordsCount);
+        }
+    }
+
+    static void reportScaledOverflow(const VerticaType &measureType)
+    {
+        vt_report_error(0, "SUM of measure type[Numeric(%d,%d)] overflows its precision, please cast it to numeric of larger precision!", 
+                        measureType.getNumericPrecision(), measureType.getNumericScale());
+    }
+
+    // note: only int64 wraparound is checked on each add, precision is checked once per cell at output by checkScaledSum. 
+    // as each value is within 10^18, a sum out of precision either stays in int64 until output, or wraps around here.
+    static inline void addScaled(const VerticaType &measureType, vint &aggregate, const vint value)
+    {
+        const vint sum = (vint)((uint64)aggregate + (uint64)value);
+        if ( ((aggregate ^ sum) & (value ^ sum)) < 0 )
+            reportScaledOverflow(measureType);
+        aggregate = sum;
+    }
+
+    // a sum needing more digits than precision of output column is reported instead of emitting an invalid numeric
+    static inline void checkScaledSum(const VerticaType &measureType, const vint sum)
+    {
+        const vint limit = PIVOT_POWERS_OF_10[measureType.getNumericPrecision()];
+        if ( sum >= limit || sum <= -limit )
+            reportScaledOverflow(measureType);
+    }
+
+    // SUM of numeric in one word as scaled int64, so that each value costs an add instead of a multi-word accumulate.
+    // note: output has same precision, so a sum of more digits than precision can not be held by output either, it is reported instead.
+    static void sumScaledBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        const vint* valuePtr = (const vint*)values;
+        vint* aggregatePtr = (vint*)aggregates;
+        for(int row = 0; row < rows; row++)
+        {
+            const int idx = columns[row];
+            const vint value = valuePtr[row];
+            if ( isNullValue(value) ) 
+                continue;
+
+            if ( isColumnSet(columnSetBits, idx) )
+                addScaled(measureType, aggregatePtr[idx], value);
+            else
+            {
+                aggregatePtr[idx] = value;
+                setColumn(columnSetBits, idx);
+            }
+        }
+    }
+
+    // COUNT of non-NULL values
+    template <typename T>
+    static void countBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        const T* valuePtr = (const T*)values;
+        vint* countPtr = (vint*)aggregates;
+        for(int row = 0; row < rows; row++)
+        {
+            if ( !isNullValue(valuePtr[row]) ) 
+            {
+                if ( isColumnSet(columnSetBits, columns[row]) )
+                    countPtr[columns[row]]++;
+                else
+                {
+                    countPtr[columns[row]] = 1;
+                    setColumn(columnSetBits, columns[row]);
+                }
+            }
+        }
+    }
+
+    static void countNumericBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        const int wordsCount = measureWords(measureType);
+        uint64* valueWordsPtr = (uint64*)values;
+        vint* countPtr = (vint*)aggregates;
+        for(int row = 0; row < rows; row++)
+        {
+            const VNumeric value(valueWordsPtr + row * wordsCount, measureType.getNumericPrecision(), measureType.getNumericScale());
+            if ( !value.isNull() ) 
+            {
+                if ( isColumnSet(columnSetBits, columns[row]) )
+                    countPtr[columns[row]]++;
+                else
+                {
+                    countPtr[columns[row]] = 1;
+                    setColumn(columnSetBits, columns[row]);
+                }
+            }
+        }
+    }
+
+    // AVG of non-NULL values, accumulated as float
+    static inline void processAverage(uint64 *columnSetBits, int idx, PivotAverage &average, const vfloat value)
+    {
+        if ( isColumnSet(columnSetBits, idx) )
+        {
+            average.sum += value;
+            average.count++;
+        }
+        else
+        {
+            average.sum = value;
+            average.count = 1;
+            setColumn(columnSetBits, idx);
+        }
+    }
+
+    template <typename T>
+    static void averageBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        const T* valuePtr = (const T*)values;
+        PivotAverage* averagePtr = (PivotAverage*)aggregates;
+        for(int row = 0; row < rows; row++)
+        {
+            if ( !isNullValue(valuePtr[row]) ) 
+                processAverage(columnSetBits, columns[row], averagePtr[columns[row]], (vfloat)valuePtr[row]);
+        }
+    }
+
+    static void averageScaledBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        vfloat scaleFactor = 1;
+        for(int sidx = 0; sidx < measureType.getNumericScale(); sidx++)
+            scaleFactor *= 10;
+        const vint* valuePtr = (const vint*)values;
+        PivotAverage* averagePtr = (PivotAverage*)aggregates;
+        for(int row = 0; row < rows; row++)
+        {
+            if ( !isNullValue(valuePtr[row]) ) 
+                processAverage(columnSetBits, columns[row], averagePtr[columns[row]], valuePtr[row] / scaleFactor);
+        }
+    }
+
+    static void averageNumericBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+        const int wordsCount = measureWords(measureType);
+        uint64* valueWordsPtr = (uint64*)values;
+        PivotAverage* averagePtr = (PivotAverage*)aggregates;
+        for(int row = 0; row < rows; row++)
+        {
+            const VNumeric value(valueWordsPtr + row * wordsCount, measureType.getNumericPrecision(), measureType.getNumericScale());
+            if ( !value.isNull() ) 
+                processAverage(columnSetBits, columns[row], averagePtr[columns[row]], value.toFloat());
+        }
+    }
+
+    // kernels merging accumulators of columns in from into same columns of aggregates, same as accumulating their values in order.
+    // note: with toColumn not -1, all columns are merged into accumulator of toColumn instead, such as folding columns out of topK into __other.
+    template <int METHOD, typename T>
+    static void mergeCells(const VerticaType &measureType, const int *columns, int count, const uint64 *fromSetBits, const void *from, uint64 *columnSetBits, void *aggregates, int toColumn)
+    {
+        const T* fromPtr = (const T*)from;
+        T* aggregatePtr = (T*)aggregates;
+        for(int cidx = 0; cidx < count; cidx++)
+        {
+            const int idx = columns[cidx];
+            const int to = (toColumn < 0)? idx : toColumn;
+            if (isColumnSet(fromSetBits, idx))
+                processValue<METHOD, T>(columnSetBits, to, aggregatePtr[to], fromPtr[idx]);
+        }
+    }
+
+    template <int METHOD>
+    static void mergeNumericCells(const VerticaType &measureType, const int *columns, int count, const uint64 *fromSetBits, const void *from, uint64 *columnSetBits, void *aggregates, int toColumn)
+    {
+        const int wordsCount = measureWords(measureType);
+        for(int cidx = 0; cidx < count; cidx++)
+        {
+            const int idx = columns[cidx];
+            if (!isColumnSet(fromSetBits, idx))
+                continue;
+            const int to = (toColumn < 0)? idx : toColumn;
+            const VNumeric value((uint64*)from + (size_t)idx * wordsCount, measureType.getNumericPrecision(), measureType.getNumericScale());
+            VNumeric aggregate((uint64*)aggregates + (size_t)to * wordsCount, measureType.getNumericPrecision(), measureType.getNumericScale());
+            processValueNumeric<METHOD>(columnSetBits, to, aggregate, &value, wordsCount);
+        }
+    }
+
+    static void mergeScaledSum(const VerticaType &measureType, const int *columns, int count, const uint64 *fromSetBits, const void *from, uint64 *columnSetBits, void *aggregates, int toColumn)
+    {
+        const vint* fromPtr = (const vint*)from;
+        vint* aggregatePtr = (vint*)aggregates;
+        for(int cidx = 0; cidx < count; cidx++)
+        {
+            const int idx = columns[cidx];
+            const int to = (toColumn < 0)? idx : toColumn;
+            if (!isColumnSet(fromSetBits, idx))
+                continue;
+            if (isColumnSet(columnSetBits, to))
+                addScaled(measureType, aggregatePtr[to], fromPtr[idx]);
+            else
+            {
+                aggregatePtr[to] = fromPtr[idx];
+                setColumn(columnSetBits, to);
+            }
+        }
+    }
+
+    static void mergeCount(const VerticaType &measureType, const int *columns, int count, const uint64 *fromSetBits, const void *from, uint64 *columnSetBits, void *aggregates, int toColumn)
+    {
+        const vint* fromPtr = (const vint*)from;
+        vint* countPtr = (vint*)aggregates;
+        for(int cidx = 0; cidx < count; cidx++)
+        {
+            const int idx = columns[cidx];
+            const int to = (toColumn < 0)? idx : toColumn;
+            if (!isColumnSet(fromSetBits, idx))
+                continue;
+            countPtr[to] = isColumnSet(columnSetBits, to)? countPtr[to] + fromPtr[idx] : fromPtr[idx];
+            setColumn(columnSetBits, to);
+        }
+    }
+
+    static void mergeAverage(const VerticaType &measureType, const int *columns, int count, const uint64 *fromSetBits, const void *from, uint64 *columnSetBits, void *aggregates, int toColumn)
+    {
+        const PivotAverage* fromPtr = (const PivotAverage*)from;
+        PivotAverage* averagePtr = (PivotAverage*)aggregates;
+        for(int cidx = 0; cidx < count; cidx++)
+        {
+            const int idx = columns[cidx];
+            const int to = (toColumn < 0)? idx : toColumn;
+            if (!isColumnSet(fromSetBits, idx))
+                continue;
+            if (isColumnSet(columnSetBits, to))
+            {
+                averagePtr[to].sum += fromPtr[idx].sum;
+                averagePtr[to].count += fromPtr[idx].count;
+            }
+            else
+            {
+                averagePtr[to] = fromPtr[idx];
+                setColumn(columnSetBits, to);
+            }
+        }
+    }
+
+    template <int METHOD>
+    static MergeFunc chooseMerge(const VerticaType &measureType)
+    {
+        if (measureType.isInt() || isPivotTemporalType(measureType) || (measureType.isNumeric() && measureWords(measureType) == 1))
+            return mergeCells<METHOD, vint>;
+        else if (measureType.isFloat())
+            return mergeCells<METHOD, vfloat>;
+        else
+            return mergeNumericCells<METHOD>;
+    }
+
+    // string aggregates are accumulated when values are gathered, nothing is left for the block
+    static void skipBlock(const VerticaType &measureType, const int *columns, int rows, const void *values, uint64 *columnSetBits, void *aggregates)
+    {
+    }
+
+    static inline int compareStrings(const VString &value, const PivotString &aggregate)
+    {
+        const uint32 length = std::min((uint32)value.length(), aggregate.length);
+        int compared = memcmp(value.data(), aggregate.data, length);
+        if (compared == 0)
+            compared = ((uint32)value.length() > aggregate.length) - ((uint32)value.length() < aggregate.length);
+        return compared;
+    }
+
+    // FIRST/LAST/MIN/MAX on string value, bytes are copied only when value replaces the aggregate.
+    // note: MIN/MAX compare bytes, not collation of locale.
+    template <int METHOD>
+    static void accumulateString(PivotStringStore &stringStore, uint64 *columnSetBits, int idx, void *aggregates, const VString &value)
+    {
+        PivotString &aggregate = ((PivotString*)aggregates)[idx];
+        const bool isSet = isColumnSet(columnSetBits, idx);
+        if ( (METHOD == PIVOT_MIN) || (METHOD == PIVOT_MAX) ) 
+        {
+            if ( value.isNull() || (isSet && ((METHOD == PIVOT_MIN)? compareStrings(value, aggregate) >= 0 : compareStrings(value, aggregate) <= 0)) ) 
+                return;
+        }
+        else if ( (METHOD == PIVOT_FIRST) && isSet )
+            return;
+
+        stringStore.assign(aggregate, isSet, value);
+        setColumn(columnSetBits, idx);
+    }
+
+    static void countString(PivotStringStore &stringStore, uint64 *columnSetBits, int idx, void *aggregates, const VString &value)
+    {
+        vint &count = ((vint*)aggregates)[idx];
+        if ( value.isNull() )
+            return;
+        if ( isColumnSet(columnSetBits, idx) )
+            count++;
+        else
+        {
+            count = 1;
+            setColumn(columnSetBits, idx);
+        }
+    }
+
+    // output aggregates of cells cellBase ... cellBase + columnsCount - 1 to output columns outputBase, outputBase + outputStride, ...
+    // note: all columns are filled with NULL constant in a loop without any branch, then only set columns in touchedColumns are overwritten.
+    static void outputInt(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                          int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride)
+    {
+        const vint* aggregateIntPtr = (const vint*)aggregates;
+        for(int idx = 0; idx < columnsCount; idx++) 
+            output_writer.setInt(outputBase + idx * outputStride, vint_null);
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int idx = touchedColumns[tidx];
+            if (isColumnSet(columnSetBits, cellBase + idx))
+                output_writer.setInt(outputBase + idx * outputStride, aggregateIntPtr[cellBase + idx]);
+        }
+    }
+
+    static void outputFloat(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                            int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride)
+    {
+        const vfloat* aggregateFloatPtr = (const vfloat*)aggregates;
+        for(int idx = 0; idx < columnsCount; idx++) 
+            output_writer.setFloat(outputBase + idx * outputStride, vfloat_null);
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int idx = touchedColumns[tidx];
+            if (isColumnSet(columnSetBits, cellBase + idx))
+                output_writer.setFloat(outputBase + idx * outputStride, aggregateFloatPtr[cellBase + idx]);
+        }
+    }
+
+    static void outputNumeric(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                              int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride)
+    {
+        const int wordsCount = measureWords(measureType);
+        uint64* aggregateWordsPtr = (uint64*)aggregates;
+        for(int idx = 0; idx < columnsCount; idx++) 
+            output_writer.getNumericRef(outputBase + idx * outputStride).setNull();
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int idx = touchedColumns[tidx];
+            if (isColumnSet(columnSetBits, cellBase + idx))
+            {
+                const VNumeric aggregate(aggregateWordsPtr + (size_t)(cellBase + idx) * wordsCount, measureType.getNumericPrecision(), measureType.getNumericScale());
+                output_writer.getNumericRef(outputBase + idx * outputStride).copy(&aggregate);
+            }
+        }
+    }
+
+    // SUM of numeric in one word: same as outputNumeric after checking precision of each set cell
+    static void outputScaledSum(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                                int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride)
+    {
+        const vint* sumPtr = (const vint*)aggregates;
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int idx = touchedColumns[tidx];
+            if (isColumnSet(columnSetBits, cellBase + idx))
+                checkScaledSum(measureType, sumPtr[cellBase + idx]);
+        }
+        outputNumeric(output_writer, measureType, columnSetBits, aggregates, columnsCount, touchedColumns, touchedCount, cellBase, outputBase, outputStride);
+    }
+
+    static void outputString(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                             int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride)
+    {
+        const PivotString* stringPtr = (const PivotString*)aggregates;
+        for(int idx = 0; idx < columnsCount; idx++) 
+            output_writer.getStringRef(outputBase + idx * outputStride).setNull();
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int idx = touchedColumns[tidx];
+            const PivotString &aggregate = stringPtr[cellBase + idx];
+            if (isColumnSet(columnSetBits, cellBase + idx) && aggregate.length != PIVOT_STRING_NULL)
+                output_writer.getStringRef(outputBase + idx * outputStride).copy(aggregate.data, aggregate.length);
+        }
+    }
+
+    // note: COUNT of column without any non-NULL value is 0, not NULL.
+    static void outputCount(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                            int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride)
+    {
+        const vint* countPtr = (const vint*)aggregates;
+        for(int idx = 0; idx < columnsCount; idx++) 
+            output_writer.setInt(outputBase + idx * outputStride, 0);
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int idx = touchedColumns[tidx];
+            if (isColumnSet(columnSetBits, cellBase + idx))
+                output_writer.setInt(outputBase + idx * outputStride, countPtr[cellBase + idx]);
+        }
+    }
+
+    static void outputAverage(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                              int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride)
+    {
+        const PivotAverage* averagePtr = (const PivotAverage*)aggregates;
+        for(int idx = 0; idx < columnsCount; idx++) 
+            output_writer.setFloat(outputBase + idx * outputStride, vfloat_null);
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int idx = touchedColumns[tidx];
+            if (isColumnSet(columnSetBits, cellBase + idx))
+                output_writer.setFloat(outputBase + idx * outputStride, averagePtr[cellBase + idx].sum / averagePtr[cellBase + idx].count);
+        }
+    }
+
+    // note: FIRST/LAST/MIN/MAX of one word numeric are same as int on scaled values, and date/timestamp are same as int.
+    template <int METHOD>
+    static AccumulateBlockFunc chooseAccumulate(const VerticaType &measureType)
+    {
+        if (measureType.isInt() || isPivotTemporalType(measureType) || (measureType.isNumeric() && measureWords(measureType) == 1))
+            return accumulateBlock<METHOD, vint>;
+        else if (measureType.isFloat())
+            return accumulateBlock<METHOD, vfloat>;
+        else
+            return accumulateNumericBlock<METHOD>;
+    }
+
+    void chooseKernels(int aidx)
+    {
+        int midx = aidx / methodsCount;
+        int methodId = methodIds[aidx % methodsCount];
+        const VerticaType &measureType = *measureTypePtrPtr[midx];
+        aggregateMeasures[aidx] = midx;
+        accumulateStringFuncs[aidx] = NULL;
+        mergeFuncs[aidx] = NULL;
+
+        if (measureKinds[midx] == MEASURE_STRING)
+        {
+            accumulateFuncs[aidx] = skipBlock;
+            outputFuncs[aidx] = outputString;
+            switch (methodId)
+            {
+            case PIVOT_COUNT:
+                accumulateStringFuncs[aidx] = countString;
+                outputFuncs[aidx] = outputCount;
+                break;
+            case PIVOT_FIRST:
+                accumulateStringFuncs[aidx] = accumulateString<PIVOT_FIRST>;
+                break;
+            case PIVOT_LAST:
+                accumulateStringFuncs[aidx] = accumulateString<PIVOT_LAST>;
+                break;
+            case PIVOT_MIN:
+                accumulateStringFuncs[aidx] = accumulateString<PIVOT_MIN>;
+                break;
+            case PIVOT_MAX:
+                accumulateStringFuncs[aidx] = accumulateString<PIVOT_MAX>;
+                break;
+            }
+            return;
+        }
+
+        switch (methodId)
+        {
+        case PIVOT_COUNT:
+            if (measureKinds[midx] == MEASURE_SCALED || measureKinds[midx] == MEASURE_INT)
+                accumulateFuncs[aidx] = countBlock<vint>;
+            else
+                accumulateFuncs[aidx] = measureType.isInt()? countBlock<vint> : (measureType.isFloat()? countBlock<vfloat> : countNumericBlock);
+            mergeFuncs[aidx] = mergeCount;
+            outputFuncs[aidx] = outputCount;
+            return;
+        case PIVOT_AVG:
+            if (measureKinds[midx] == MEASURE_SCALED)
+                accumulateFuncs[aidx] = averageScaledBlock;
+            else
+                accumulateFuncs[aidx] = measureType.isInt()? averageBlock<vint> : (measureType.isFloat()? averageBlock<vfloat> : averageNumericBlock);
+            mergeFuncs[aidx] = mergeAverage;
+            outputFuncs[aidx] = outputAverage;
+            return;
+        case PIVOT_FIRST:
+            accumulateFuncs[aidx] = chooseAccumulate<PIVOT_FIRST>(measureType);
+            mergeFuncs[aidx] = chooseMerge<PIVOT_FIRST>(measureType);
+            break;
+        case PIVOT_LAST:
+            accumulateFuncs[aidx] = chooseAccumulate<PIVOT_LAST>(measureType);
+            mergeFuncs[aidx] = chooseMerge<PIVOT_LAST>(measureType);
+            break;
+        case PIVOT_MIN:
+            accumulateFuncs[aidx] = chooseAccumulate<PIVOT_MIN>(measureType);
+            mergeFuncs[aidx] = chooseMerge<PIVOT_MIN>(measureType);
+            break;
+        case PIVOT_MAX:
+            accumulateFuncs[aidx] = chooseAccumulate<PIVOT_MAX>(measureType);
+            mergeFuncs[aidx] = chooseMerge<PIVOT_MAX>(measureType);
+            break;
+        default:
+            if (measureKinds[midx] == MEASURE_SCALED)
+            {
+                accumulateFuncs[aidx] = sumScaledBlock;
+                mergeFuncs[aidx] = mergeScaledSum;
+            }
+            else
+            {
+                accumulateFuncs[aidx] = chooseAccumulate<PIVOT_SUM>(measureType);
+                mergeFuncs[aidx] = chooseMerge<PIVOT_SUM>(measureType);
+            }
+            break;
+        }
+
+        if (measureKinds[midx] == MEASURE_INT)
+            outputFuncs[aidx] = outputInt;
+        else if (methodId == PIVOT_SUM && measureKinds[midx] == MEASURE_SCALED)
+            outputFuncs[aidx] = outputScaledSum;
+        else if (measureType.isFloat())
+            outputFuncs[aidx] = outputFloat;
+        else
+            outputFuncs[aidx] = outputNumeric;
+    }
+
+    // aggregate methods operate on from 2nd parameter: each aggregate accumulates the whole block in one tight loop
+    inline void accumulateBlockRows(int rows)
+    {
+        profile.rowsMatched += rows;
+        profile.numericAccumulations += (vint)rows * numericAggregateCount;
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
+            accumulateFuncs[aidx](*measureTypePtrPtr[aggregateMeasures[aidx]], blockColumns, rows, blockValuesPtrPtr[aggregateMeasures[aidx]], 
+                                  columnSetBits + aidx * bitmapWordsCount, aggregatePtrPtr[aidx]);
+    }
+
+    // position of value of argument column in dimension, or -1 if it is not in values of dimension
+    static inline int findDimension(const PivotDimension &dimension, PartitionReader &input_reader, size_t column)
+    {
+        switch (dimension.keyKind)
+        {
+        case PIVOT_KEY_INT:
+            return dimension.nativeColumnIndex.find(input_reader.getIntRef(column));
+        case PIVOT_KEY_DATE:
+            return dimension.nativeColumnIndex.find(input_reader.getDateRef(column));
+        case PIVOT_KEY_TIMESTAMP:
+            return dimension.nativeColumnIndex.find(input_reader.getTimestampRef(column));
+        default:
+        {
+            const VString& gby = input_reader.getStringRef(column);
+            return dimension.columnIndex.find(gby.data(), gby.length());
+        }
+        }
+    }
+
+    // column position of measureName of current row, or -1 if it is not in columns
+    template <int KEY_KIND>
+    inline int findColumn(PartitionReader &input_reader) const
+    {
+        if (KEY_KIND == PIVOT_KEY_DIMENSIONS)
+        {
+            int idx = 0;
+            for(int didx = 0; didx < dimensionsCount; didx++)
+            {
+                const int position = findDimension(dimensions[didx], input_reader, keyCount + didx);
+                if (position < 0)
+                    return -1;
+                idx = idx * dimensions[didx].size + position;
+            }
+            return idx;
+        }
+        else if (KEY_KIND == PIVOT_KEY_INT)
+            return nativeColumnIndex.find(input_reader.getIntRef(keyCount));
+        else if (KEY_KIND == PIVOT_KEY_DATE)
+            return nativeColumnIndex.find(input_reader.getDateRef(keyCount));
+        else if (KEY_KIND == PIVOT_KEY_TIMESTAMP)
+            return nativeColumnIndex.find(input_reader.getTimestampRef(keyCount));
+
+        const VString& gby = input_reader.getStringRef(keyCount);
+        int idx = columnIndex.find(gby.data(), gby.length());
+#ifdef PIVOT_DEBUG
+        std::map<std::string, int>::const_iterator i = columnNames.find(gby.str());
+        if( (i != columnNames.end() ? i->second : -1) != idx )
+            vt_report_error(0, "Column index of [%s] is [%d], but should be [%d]!", gby.str().c_str(), idx, (i != columnNames.end() ? i->second : -1));
+#endif
+        return idx;
+    }
+
+    template <int KEY_KIND>
+    ProcessRowsFunc chooseProcessRows(bool groups)
+    {
+        if (groups)
+            return &Pivot::processGroups<KEY_KIND>;
+        else
+            return &Pivot::processRows<KEY_KIND>;
+    }
+
+    void chooseProcessRows()
+    {
+        switch (keyKind)
+        {
+        case PIVOT_KEY_INT:
+            processRowsFunc = chooseProcessRows<PIVOT_KEY_INT>(keyCount > 0);
+            break;
+        case PIVOT_KEY_DATE:
+            processRowsFunc = chooseProcessRows<PIVOT_KEY_DATE>(keyCount > 0);
+            break;
+        case PIVOT_KEY_TIMESTAMP:
+            processRowsFunc = chooseProcessRows<PIVOT_KEY_TIMESTAMP>(keyCount > 0);
+            break;
+        case PIVOT_KEY_DIMENSIONS:
+            processRowsFunc = chooseProcessRows<PIVOT_KEY_DIMENSIONS>(keyCount > 0);
+            break;
+        default:
+            processRowsFunc = chooseProcessRows<PIVOT_KEY_STRING>(keyCount > 0);
+            break;
+        }
+    }
+
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  PartitionReader &input_reader,
+                                  PartitionWriter &output_writer)
+    {
+        if (input_reader.getNumCols() != (size_t)(measureBase + measureCount))
+            vt_report_error(0, "Function need %zu arguments, but %zu provided", (size_t)(measureBase + measureCount), input_reader.getNumCols());
+
+        profile.partitions++;
+        (this->*processRowsFunc)(input_reader, output_writer);
+    }
+
+    // partition mode: aggregate methods operate on from 2nd parameter group by 1st parameter in each partition, considering NULL.
+    // note: rows are processed block by block, column indices and values of a block are collected first, 
+    // then each aggregate accumulates the whole block in one tight loop, so all methods are calculated in one pass.
+    template <int KEY_KIND>
+    void processRows(PartitionReader &input_reader, PartitionWriter &output_writer)
+    {
+        uint64 mark = 0;
+        profile.start(mark);
+        bool hasMoreRows = true;
+        while (hasMoreRows) 
+        {
+            int rows = 0;
+            int rowsRead = 0;
+            do {
+                // group by on 1st parameter 
+                int idx = findColumn<KEY_KIND>(input_reader);
+
+                // skip rows not in columnsFilter, unless they go to __other
+                if (idx < 0)
+                    idx = otherColumn;
+                if(idx >= 0) 
+                {
+                    if (!isColumnSet(touchedBits, idx))
+                    {
+                        setColumn(touchedBits, idx);
+                        touchedColumns[touchedCount++] = idx;
+                    }
+                    blockColumns[rows] = idx;
+                    gatherValues(input_reader, blockValuesPtrPtr, blockColumns, rows);
+                    rows++;
+                }
+
+                rowsRead++;
+                hasMoreRows = input_reader.next();
+            } while (hasMoreRows && rows < PIVOT_BLOCK_ROWS);
+            profile.rowsRead += rowsRead;
+            profile.lap(profile.lookupCycles, mark);
+
+            accumulateBlockRows(rows);
+            profile.lap(profile.accumulateCycles, mark);
+        }
+
+        outputRow(output_writer, mark);
+    }
+
+    // weight of cell ranking its column in topK: value of 1st aggregate, or the lowest if it's not set
+    double cellWeight(int cell) const
+    {
+        if (!isColumnSet(columnSetBits, cell))
+            return -HUGE_VAL;
+        double weight;
+        if (methodIds[0] == PIVOT_COUNT)
+            weight = ((const vint*)aggregatePtrPtr[0])[cell];
+        else if (methodIds[0] == PIVOT_AVG)
+            weight = ((const PivotAverage*)aggregatePtrPtr[0])[cell].sum / ((const PivotAverage*)aggregatePtrPtr[0])[cell].count;
+        else if (measureKinds[0] == MEASURE_FLOAT)
+            weight = ((const vfloat*)aggregatePtrPtr[0])[cell];
+        else if (measureKinds[0] == MEASURE_NUMERIC)
+        {
+            const VNumeric aggregate((uint64*)aggregatePtrPtr[0] + (size_t)cell * measureWordsCounts[0], 
+                                     measureTypePtrPtr[0]->getNumericPrecision(), measureTypePtrPtr[0]->getNumericScale());
+            weight = aggregate.toFloat();
+        }
+        else
+            // note: scaled numeric is ranked by its scaled value, same order as numeric.
+            weight = ((const vint*)aggregatePtrPtr[0])[cell];
+        return (weight == weight)? weight : -HUGE_VAL;
+    }
+
+    // order of columns in topK: larger weight first, then former column first
+    struct HeavierColumn
+    {
+        const double* weights;
+
+        bool operator()(int left, int right) const
+        {
+            return weights[left] > weights[right] || (weights[left] == weights[right] && left < right);
+        }
+    };
+
+    // topK: move topK columns of largest weight to front of columns [count] of a row from cellBase, and __other after them if it's required, 
+    // fold cells of the other columns into __other in order of columns, and return count of columns to write.
+    // note: columns still lists all of them, __other is appended and count is increased if it's not listed yet.
+    int selectTopColumns(int *columns, int &count, int cellBase)
+    {
+        int rankedCount = 0;
+        for(int cidx = 0; cidx < count; cidx++)
+        {
+            if (columns[cidx] != otherColumn)
+                columns[rankedCount++] = columns[cidx];
+        }
+        if (rankedCount <= topK)
+        {
+            if (rankedCount < count)
+                columns[rankedCount] = otherColumn;
+            return count;
+        }
+
+        for(int cidx = 0; cidx < rankedCount; cidx++)
+            columnWeights[columns[cidx]] = cellWeight(cellBase + columns[cidx]);
+        HeavierColumn heavier = {columnWeights};
+        std::nth_element(columns, columns + topK, columns + rankedCount, heavier);
+        if (otherColumn < 0)
+            return topK;
+
+        const int foldCount = rankedCount - topK;
+        for(int cidx = 0; cidx < foldCount; cidx++)
+            foldCells[cidx] = cellBase + columns[topK + cidx];
+        std::sort(foldCells, foldCells + foldCount);
+        // note: COUNT on string measure is the only string aggregate allowed with __other, and it has no merge kernel of its own.
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
+        {
+            const MergeFunc merge = (mergeFuncs[aidx] != NULL)? mergeFuncs[aidx] : mergeCount;
+            merge(*measureTypePtrPtr[aggregateMeasures[aidx]], foldCells, foldCount, columnSetBits + aidx * bitmapWordsCount, aggregatePtrPtr[aidx], 
+                  columnSetBits + aidx * bitmapWordsCount, aggregatePtrPtr[aidx], cellBase + otherColumn);
+        }
+        columns[rankedCount] = columns[topK];
+        columns[topK] = otherColumn;
+        count = rankedCount + 1;
+        return topK + 1;
+    }
+
+    // partition mode: write the row of partition, and re-init buffer for next partition
+    void outputRow(PartitionWriter &output_writer, uint64 &mark)
+    {
+        // output
+        // note: loop hurt performance. Even just loop 1 time, running processPartition 500M times with 80 columns need more 2 seconds.
+        // so each aggregate writes all of its columns in one kernel call, column idx of aggregate aidx is output column idx * aggregateCount + aidx.
+        // note: with topK, touched columns kept are moved to front of touchedColumns, which still lists all of them for resetting.
+        int outputCount = touchedCount;
+        if (topK > 0 && touchedCount > topK)
+            outputCount = selectTopColumns(touchedColumns, touchedCount, 0);
+        if (packedOutput)
+        {
+            // note: touched columns are listed again in ascending order from touchedBits, cheaper than sorting them.
+            if (outputCount == touchedCount)
+            {
+                int sortedCount = 0;
+                for(int word = 0; word < (columnsCount + 63) / 64; word++)
+                {
+                    for(uint64 bits = touchedBits[word]; bits != 0; bits &= bits - 1)
+                        touchedColumns[sortedCount++] = word * 64 + __builtin_ctzll(bits);
+                }
+            }
+            else
+                std::sort(touchedColumns, touchedColumns + outputCount);
+            outputPacked(output_writer, touchedColumns, outputCount, 0, 0);
+        }
+        else if (aggregateCount == 1)
+            outputFuncs[0](output_writer, *measureTypePtrPtr[0], columnSetBits, aggregatePtrPtr[0], columnsCount, touchedColumns, outputCount, 0, 0, 1);
+        else
+        {
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                outputFuncs[aidx](output_writer, *measureTypePtrPtr[aggregateMeasures[aidx]], columnSetBits + aidx * bitmapWordsCount, aggregatePtrPtr[aidx], 
+                                  columnsCount, touchedColumns, outputCount, 0, aidx, aggregateCount);
+        }
+
+        output_writer.next();
+        profile.outputRows++;
+        profile.outputCells += packedOutput? 1 : (vint)columnsCount * aggregateCount;
+        profile.lap(profile.outputCycles, mark);
+
+        // re-init buffer for next partition: values of columns not set are never read, so only bitmaps words of touched columns need clearing.
+        // note: every set bit belongs to a touched column, so clearing whole words is safe.
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int word = touchedColumns[tidx] >> 6;
+            touchedBits[word] = 0;
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                columnSetBits[aidx * bitmapWordsCount + word] = 0;
+        }
+        touchedCount = 0;
+        stringStore.reset();
+    }
+
+    // hash mode: rows of many groups in one call are accumulated into cells of their groups without any sorting, 
+    // a row is written for each group when groups reach capacity or input of this call ends.
+    // note: every group seen is written, even if none of its rows matches columnsFilter, like GROUP BY.
+    template <int KEY_KIND>
+    void processGroups(PartitionReader &input_reader, PartitionWriter &output_writer)
+    {
+        uint64 mark = 0;
+        profile.start(mark);
+        bool hasMoreRows = true;
+        while (hasMoreRows) 
+        {
+            int rows = 0;
+            int rowsRead = 0;
+            do {
+                groupKeyCodec.encode(input_reader, groupKey);
+                int group = groupIndex.findOrInsert(groupKey.data(), groupKey.length());
+
+                int idx = findColumn<KEY_KIND>(input_reader);
+                if (idx < 0)
+                    idx = otherColumn;
+                if(idx >= 0) 
+                {
+                    blockColumns[rows] = group * columnsCount + idx;
+                    gatherValues(input_reader, blockValuesPtrPtr, blockColumns, rows);
+                    rows++;
+                }
+
+                rowsRead++;
+                hasMoreRows = input_reader.next();
+            } while (hasMoreRows && rows < PIVOT_BLOCK_ROWS && groupIndex.size() < groupsCapacity);
+            profile.rowsRead += rowsRead;
+            profile.lap(profile.lookupCycles, mark);
+
+            accumulateBlockRows(rows);
+            profile.lap(profile.accumulateCycles, mark);
+
+            if (!hasMoreRows || groupIndex.size() >= groupsCapacity)
+            {
+                flushGroups(output_writer);
+                profile.lap(profile.outputCycles, mark);
+            }
+        }
+    }
+
+    void flushGroups(PartitionWriter &output_writer)
+    {
+        int groupsCount = groupIndex.size();
+        for(int group = 0; group < groupsCount && partialOutput; group++)
+            outputPartials(output_writer, group);
+        for(int group = 0; group < groupsCount && !partialOutput; group++)
+        {
+            groupKeyCodec.decode(output_writer, 0, groupIndex.key(group));
+            const int* columns = allColumns;
+            int outputCount = columnsCount;
+            if (topK > 0)
+            {
+                // note: columns set in any aggregate of the group are listed in touchedColumns, which is not used in hash mode.
+                int setCount = 0;
+                for(int idx = 0; idx < columnsCount; idx++)
+                {
+                    for(int aidx = 0; aidx < aggregateCount; aidx++)
+                    {
+                        if (isColumnSet(columnSetBits + aidx * bitmapWordsCount, group * columnsCount + idx))
+                        {
+                            touchedColumns[setCount++] = idx;
+                            break;
+                        }
+                    }
+                }
+                outputCount = (setCount > topK)? selectTopColumns(touchedColumns, setCount, group * columnsCount) : setCount;
+                if (packedOutput)
+                    std::sort(touchedColumns, touchedColumns + outputCount);
+                columns = touchedColumns;
+            }
+            if (packedOutput)
+                outputPacked(output_writer, columns, outputCount, group * columnsCount, keyCount);
+            for(int aidx = 0; aidx < aggregateCount && !packedOutput; aidx++)
+                outputFuncs[aidx](output_writer, *measureTypePtrPtr[aggregateMeasures[aidx]], columnSetBits + aidx * bitmapWordsCount, aggregatePtrPtr[aidx], 
+                                  columnsCount, columns, outputCount, group * columnsCount, keyCount + aidx, aggregateCount);
+            output_writer.next();
+        }
+        if (!partialOutput)
+        {
+            profile.outputRows += groupsCount;
+            profile.outputCells += (vint)groupsCount * (keyCount + (packedOutput? 1 : columnsCount * aggregateCount));
+        }
+
+        // re-init bitmaps of used cells
+        size_t usedWords = ((size_t)groupsCount * columnsCount + 63) / 64;
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
+            memset(columnSetBits + aidx * bitmapWordsCount, 0, sizeof(uint64) * usedWords);
+        groupIndex.clear();
+        stringStore.reset();
+    }
+
+    // write cells set in any aggregate of columns cellBase + columns[0...count-1] as a packed value to output column outputColumn.
+    // note: columns should be ascending, so that values are packed in order of cells.
+    void outputPacked(PartitionWriter &output_writer, const int *columns, int count, int cellBase, int outputColumn)
+    {
+        const size_t bitmapBytes = ((size_t)columnsCount * aggregateCount + 7) / 8;
+        unsigned char* bitmapPtr = (unsigned char*)packedBuffer + packedHeaderBytes;
+        char* valuePtr = (char*)bitmapPtr + bitmapBytes;
+        memset(bitmapPtr, 0, bitmapBytes);
+        for(int tidx = 0; tidx < count; tidx++)
+        {
+            const int cell = cellBase + columns[tidx];
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+            {
+                if (!isColumnSet(columnSetBits + aidx * bitmapWordsCount, cell))
+                    continue;
+
+                const int packedCell = columns[tidx] * aggregateCount + aidx;
+                bitmapPtr[packedCell >> 3] |= (unsigned char)(1 << (packedCell & 7));
+                const int midx = aggregateMeasures[aidx];
+                const int methodId = methodIds[aidx % methodsCount];
+                if (methodId == PIVOT_AVG)
+                {
+                    const PivotAverage &average = ((const PivotAverage*)aggregatePtrPtr[aidx])[cell];
+                    const vfloat value = average.sum / average.count;
+                    memcpy(valuePtr, &value, sizeof(vfloat));
+                    valuePtr += sizeof(vfloat);
+                }
+                else if (methodId == PIVOT_COUNT || measureKinds[midx] != MEASURE_NUMERIC)
+                {
+                    if (methodId == PIVOT_SUM && measureKinds[midx] == MEASURE_SCALED)
+                        checkScaledSum(*measureTypePtrPtr[midx], ((const vint*)aggregatePtrPtr[aidx])[cell]);
+                    // note: vint, vfloat and numeric of one word are all 8 bytes
+                    memcpy(valuePtr, (const uint64*)aggregatePtrPtr[aidx] + cell, sizeof(uint64));
+                    valuePtr += sizeof(uint64);
+                }
+                else
+                {
+                    memcpy(valuePtr, (const uint64*)aggregatePtrPtr[aidx] + (size_t)cell * measureWordsCounts[midx], sizeof(uint64) * measureWordsCounts[midx]);
+                    valuePtr += sizeof(uint64) * measureWordsCounts[midx];
+                }
+            }
+        }
+        output_writer.getStringRef(outputColumn).copy(packedBuffer, valuePtr - packedBuffer);
+    }
+
+    // write partial aggregate of aggregate aidx in cell to output column outputColumn, and return next output column.
+    // note: partial of column not set is NULL, or 0 for COUNT, AVG is sum and count in 2 columns.
+    int outputPartial(PartitionWriter &output_writer, int aidx, int cell, int outputColumn)
+    {
+        const bool isSet = isColumnSet(columnSetBits + aidx * bitmapWordsCount, cell);
+        const int midx = aggregateMeasures[aidx];
+        switch (methodIds[aidx % methodsCount])
+        {
+        case PIVOT_COUNT:
+            output_writer.setInt(outputColumn, isSet? ((const vint*)aggregatePtrPtr[aidx])[cell] : 0);
+            return outputColumn + 1;
+        case PIVOT_AVG:
+        {
+            const PivotAverage &average = ((const PivotAverage*)aggregatePtrPtr[aidx])[cell];
+            output_writer.setFloat(outputColumn, isSet? average.sum : vfloat_null);
+            output_writer.setInt(outputColumn + 1, isSet? average.count : 0);
+            return outputColumn + 2;
+        }
+        }
+
+        switch (measureKinds[midx])
+        {
+        case MEASURE_INT:
+            output_writer.setInt(outputColumn, isSet? ((const vint*)aggregatePtrPtr[aidx])[cell] : vint_null);
+            break;
+        case MEASURE_FLOAT:
+            output_writer.setFloat(outputColumn, isSet? ((const vfloat*)aggregatePtrPtr[aidx])[cell] : vfloat_null);
+            break;
+        case MEASURE_NUMERIC:
+        case MEASURE_SCALED:
+            if (isSet)
+            {
+                const VerticaType &measureType = *measureTypePtrPtr[midx];
+                if (methodIds[aidx % methodsCount] == PIVOT_SUM && measureKinds[midx] == MEASURE_SCALED)
+                    checkScaledSum(measureType, ((const vint*)aggregatePtrPtr[aidx])[cell]);
+                const VNumeric aggregate((uint64*)aggregatePtrPtr[aidx] + (size_t)cell * measureWordsCounts[midx], 
+                                         measureType.getNumericPrecision(), measureType.getNumericScale());
+                output_writer.getNumericRef(outputColumn).copy(&aggregate);
+            }
+            else
+                output_writer.getNumericRef(outputColumn).setNull();
+            break;
+        case MEASURE_STRING:
+            // note: never happens, PivotMultiPhase rejects string measures in setup.
+            break;
+        }
+        return outputColumn + 1;
+    }
+
+    // write a row of group keys, column index and partials for each column set in any aggregate of group,
+    // or a row with NULL column index if there is none, so that the group still has its row after merging.
+    void outputPartials(PartitionWriter &output_writer, int group)
+    {
+        bool hasPartial = false;
+        for(int idx = 0; idx < columnsCount; idx++)
+        {
+            const int cell = group * columnsCount + idx;
+            bool isSet = false;
+            for(int aidx = 0; aidx < aggregateCount && !isSet; aidx++)
+                isSet = isColumnSet(columnSetBits + aidx * bitmapWordsCount, cell);
+            if (!isSet)
+                continue;
+
+            groupKeyCodec.decode(output_writer, 0, groupIndex.key(group));
+            output_writer.setInt(keyCount, idx);
+            int outputColumn = keyCount + 1;
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                outputColumn = outputPartial(output_writer, aidx, cell, outputColumn);
+            output_writer.next();
+            profile.outputRows++;
+            profile.outputCells += outputColumn;
+            hasPartial = true;
+        }
+
+        if (!hasPartial)
+        {
+            groupKeyCodec.decode(output_writer, 0, groupIndex.key(group));
+            output_writer.setInt(keyCount, vint_null);
+            int outputColumn = keyCount + 1;
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                outputColumn = outputPartial(output_writer, aidx, group * columnsCount, outputColumn);
+            output_writer.next();
+            profile.outputRows++;
+            profile.outputCells += outputColumn;
+        }
+    }
+};
+
+
+// check arguments and get parameters of pivot, shared by Pivot and PivotMultiPhase
+inline void getPivotSignature(ServerInterface &srvInterface, const SizedColumnTypes &input_types, int &keyCount, int &measureBase, int &measureCount, 
+                              std::vector<int> &methodIds, std::vector<std::string> &methodNames, std::vector<std::string> &columnKeys)
+{
+    ParamReader paramReader = srvInterface.getParamReader();
 
-    // buffer for SUM/FIRST/LAST operations: vint/vfloat/VNumeric* [measureCount][columnsCount]
-    // note: use VNumeric* except VNumeric, because there is no default constructor of class VNumeric for convenient initializing array. 
-    void** measurePtrPtr;
+    // check arguments
+    if ( input_types.getColumnCount() < 2 ) 
+        vt_report_error(0, "There should be 2 or more arguments, but [%zu] arguments are provided!", input_types.getColumnCount());
+    keyCount = getPivotGroupKeys(paramReader, input_types);
+    std::vector<int> keyKinds;
+    const int dimensions = getPivotDimensionArguments(paramReader, input_types, keyCount, keyKinds);
+    measureBase = keyCount + dimensions;
+    measureCount = input_types.getColumnCount() - measureBase;
 
-public:
-    Pivot(): measureCount(0), measureTypePtrPtr(NULL), columnsCount(0), columnNames(NULL), method(DEFAULT_method), measurePtrPtr(NULL)
+    // get parameters
+    std::string method = DEFAULT_method;
+    if (paramReader.containsParameter("method"))
+        method = paramReader.getStringRef("method").str();
+    parsePivotMethods(method, methodIds, methodNames);
+    for(int midx = 0; midx < measureCount; midx++)
+        checkPivotMeasureType(input_types.getColumnType(measureBase+midx), measureBase+midx+1, methodIds, methodNames);
+    getPivotColumnKeys(paramReader, columnKeys);
+    std::vector<std::vector<std::string> > dimensionKeys;
+    if (dimensions > 1)
+        getPivotDimensionKeys(paramReader, dimensionKeys);
+    else
+        dimensionKeys.assign(1, columnKeys);
+    for(int didx = 0; didx < dimensions; didx++)
     {
+        if (keyKinds[didx] != PIVOT_KEY_STRING)
+        {
+            std::vector<int64> nativeKeys;
+            getPivotNativeKeys(keyKinds[didx], dimensionKeys[didx], nativeKeys);
+        }
     }
+    if (getPivotOtherColumn(paramReader))
+        columnKeys.push_back(OTHER_COLUMN_name);
+}
 
-	virtual void setup (ServerInterface &srvInterface, const SizedColumnTypes &input_types)
+inline void addPivotParameterTypes(SizedColumnTypes &parameterTypes)
+{
+    parameterTypes.addVarchar(65000, "columnsFilter");
+    //parameter: ranges of integers or dates such as '2003-01-01..2003-03-21' separated by separator, generating columns after columnsFilter.
+    parameterTypes.addVarchar(1000, "columnsRange");
+    //parameter: upper limit of columns generated by each columnsRange, default value is 1600.
+    parameterTypes.addInt("maxColumns");
+    //parameter: separator string for columnNames, default value is ','.
+    parameterTypes.addVarchar(1, "separator");
+    //parameter: one or more methods separated by ',', such as 'SUM,MAX,COUNT'.
+    parameterTypes.addVarchar(64, "method");
+    //parameter: count of leading group key arguments in hash mode, default value is 0 means partition mode.
+    parameterTypes.addInt("groupKeys");
+    //parameter: upper limit of groups kept before flush in hash mode.
+    parameterTypes.addInt("maxGroups");
+    //parameter: log counters and timers of hot path when function instance is destroyed, default value is false.
+    parameterTypes.addBool("profile");
+    //parameter: upper limit of memory of each function instance in MB, default value is 1024.
+    parameterTypes.addInt("maxMemory");
+    //parameter: count of measureName arguments, whose cross product are columns, default value is 1.
+    parameterTypes.addInt("dimensions");
+    //parameter: separator between lists of dimensions in columnsFilter and columnsRange, default value is ';'.
+    parameterTypes.addVarchar(1, "dimensionSeparator");
+    //parameter: accumulate rows out of columns into an extra last column "__other", default value is false.
+    parameterTypes.addBool("otherColumn");
+}
+
+// declare memory of an instance of Pivot, same as its setup would allocate.
+inline void getPivotPerInstanceResources(ServerInterface &srvInterface, VResources &res, const SizedColumnTypes &input_types, bool partialOutput)
+{
+    Pivot pivot(partialOutput);
+    try
     {
-        // check arguments
-        measureCount = input_types.getColumnCount() - 1;
-        if ( measureCount < 1 ) 
-            vt_report_error(0, "There should be 2 or more arguments, but [%zu] arguments are provided!", input_types.getColumnCount());
+        pivot.configure(srvInterface, input_types);
+    }
+    catch (...)
+    {
+        pivot.release();
+        throw;
+    }
+    res.scratchMemory += pivot.memoryBytes();
+    pivot.release();
+}
 
-        VerticaType columnsFilterType = input_types.getColumnType(0);
-        if ( ! columnsFilterType.isStringType() )
-            vt_report_error(0, "The 1st argument should be string, but type[%s] is provided!", columnsFilterType.getTypeStr());
 
-        measureTypePtrPtr = new VerticaType*[measureCount];
-        for(int midx = 0; midx < measureCount; midx++)
-        {
-            measureTypePtrPtr[midx] = new VerticaType(VUnspecOID, 0);
-            (*measureTypePtrPtr[midx]) = input_types.getColumnType(midx+1);
-            if ( !(*measureTypePtrPtr[midx]).isInt() && !(*measureTypePtrPtr[midx]).isFloat() && !(*measureTypePtrPtr[midx]).isNumeric() ) 
-            {
-                for(; midx>=0; midx--)
-                    delete measureTypePtrPtr[midx];
+class PivotFactory : public TransformFunctionFactory
+{
+    virtual void getPrototype(ServerInterface &srvInterface, ColumnTypes &input_types, ColumnTypes &returnType)
+    {
+        // get parameters
+        ParamReader paramReader = srvInterface.getParamReader();
 
-                delete[] measureTypePtrPtr;
-                measureTypePtrPtr = NULL;
-                vt_report_error(0, "The [%zu] argument should be int, float or numeric, but type[%s] is provided!", measureCount + 1, input_types.getColumnType(midx+1).getTypeStr());
-            }
-        }
+        input_types.addAny();
+        
+        // Note: need not add any type to returnType. empty returnType means any columnsFilter and types!
+    }
 
-        // get parameters
+    virtual void getReturnType(ServerInterface &srvInterface, const SizedColumnTypes &input_types, SizedColumnTypes &output_types)
+    {
+        int keyCount, measureBase, measureCount;
+        std::vector<int> methodIds;
+        std::vector<std::string> methodNames;
+        std::vector<std::string> columnKeys;
+        getPivotSignature(srvInterface, input_types, keyCount, measureBase, measureCount, methodIds, methodNames, columnKeys);
+
+        // output: group keys in hash mode
+        for(int kidx = 0; kidx < keyCount; kidx++)
+            output_types.addArg(input_types.getColumnType(kidx), input_types.getColumnName(kidx));
+
+        // output: all cells in one packed column
         ParamReader paramReader = srvInterface.getParamReader();
-        if (paramReader.containsParameter("method"))
-            method = paramReader.getStringRef("method").str();
-            std::transform(method.begin(), method.end(), method.begin(), ::toupper);
-        std::string separator = DEFAULT_separator;
-        if (paramReader.containsParameter("separator"))
-            separator = paramReader.getStringRef("separator").str();
-        std::string columnsFilter = "";
-        if (paramReader.containsParameter("columnsFilter"))
-            columnsFilter = paramReader.getStringRef("columnsFilter").str();
-        else 
-            vt_report_error(0, "Function need at least parameter [columnsFilter]!");
-
-        // split columnsFilter
-        columnsCount = 0;
-        istringstream ss(columnsFilter);
-        const char delim = separator.c_str()[0];
-        std::string token;
-        while (getline(ss, token, delim))
-            columnsCount++;
-
-        columnNames = new std::map<std::string, int>;
-        istringstream ss2(columnsFilter);
-        int idx = 0;
-        while (getline(ss2, token, delim))
-            (*columnNames)[token] = idx++;
+        if (getPivotPackedOutput(paramReader))
+        {
+            checkPivotNumericMeasures(input_types, measureBase, measureCount, "outputFormat=packed");
+            size_t maxSize = 0;
+            PivotPacked::writeHeader(NULL, input_types, measureBase, measureCount, methodIds, columnKeys.size(), 
+                                     getPivotSetColumns(columnKeys.size(), getPivotTopK(paramReader), getPivotOtherColumn(paramReader)), maxSize);
+            if (maxSize > PACKED_MAX_LONG_VARBINARY)
+                vt_report_error(0, "Packed output of [%zu] bytes is longer than [%d] bytes, please reduce columns, measures or methods!", maxSize, PACKED_MAX_LONG_VARBINARY);
+            else if (maxSize > PACKED_MAX_VARBINARY)
+                output_types.addLongVarbinary(maxSize, "pivot");
+            else
+                output_types.addVarbinary(maxSize, "pivot");
+            return;
+        }
 
-        // allocate buffer
-        measurePtrPtr = new void*[measureCount];
-        for(int midx = 0; midx < measureCount; midx++)
+        // output: for each column, each measure, each method
+        for(size_t idx = 0; idx < columnKeys.size(); idx++) 
         {
-            if ((*measureTypePtrPtr[midx]).isInt())
-                measurePtrPtr[midx] = (void *) new vint[columnsCount];
-            else if ((*measureTypePtrPtr[midx]).isFloat())
-                measurePtrPtr[midx] = (void *) new vfloat[columnsCount];
-            else if ((*measureTypePtrPtr[midx]).isNumeric())
+            for(int midx = 0; midx < measureCount; midx++)
             {
-                int wordsCount = ((*measureTypePtrPtr[midx]).getNumericPrecision()+19)/19;
-                uint64* wordsPtr = new uint64[wordsCount*columnsCount];
-                measurePtrPtr[midx] = (void *) new VNumeric*[columnsCount];
-                for(int idx = 0; idx < columnsCount; idx++)
-                    ((VNumeric**)measurePtrPtr[midx])[idx] = new VNumeric(wordsPtr + wordsCount*idx, 
-                                (*measureTypePtrPtr[midx]).getNumericPrecision(), (*measureTypePtrPtr[midx]).getNumericScale());
+                for(size_t kidx = 0; kidx < methodIds.size(); kidx++)
+                    addPivotOutputType(output_types, input_types.getColumnType(measureBase+midx), methodIds[kidx], 
+                                       pivotColumnName(columnKeys[idx], midx, methodNames[kidx], methodIds.size() > 1));
             }
         }
     }
 
-	virtual void destroy (ServerInterface &srvInterface, const SizedColumnTypes &input_types){
-        // free buffer
-        if (measurePtrPtr != NULL) 
-        {
-            for(int midx = 0; midx < measureCount; midx++)
-            {
-                if ((*measureTypePtrPtr[midx]).isInt())
-                    delete[] (vint*)measurePtrPtr[midx]; 
-                else if ((*measureTypePtrPtr[midx]).isFloat())
-                    delete[] (vfloat*)measurePtrPtr[midx]; 
-                else if ((*measureTypePtrPtr[midx]).isNumeric())
-                {
-                    uint64* wordsPtr = ((VNumeric**)measurePtrPtr[midx])[0]->words;
+    // Defines the parameters for this UDSF. Works similarly to defining
+    // arguments and return types.
+    virtual void getParameterType(ServerInterface &srvInterface, SizedColumnTypes &parameterTypes) 
+    {
+        addPivotParameterTypes(parameterTypes);
+        //parameter: COLUMNS for a column of each cell, or PACKED for all cells in one varbinary column extracted by pivotcell, default value is COLUMNS.
+        parameterTypes.addVarchar(16, "outputFormat");
+        //parameter: count of columns of largest 1st aggregate written in each row, others are NULL or folded into __other, default value is 0 means all columns.
+        parameterTypes.addInt("topK");
+    }
 
-                    for(int idx = 0; idx < columnsCount; idx++) 
-                        delete ((VNumeric**)measurePtrPtr[midx])[idx];
-                    delete[] (VNumeric**)measurePtrPtr[midx]; 
 
-                    delete[] wordsPtr;
-                }
-            }
+    virtual void getPerInstanceResources(ServerInterface &srvInterface, VResources &res, const SizedColumnTypes &input_types)
+    {
+        getPivotPerInstanceResources(srvInterface, res, input_types, false);
+    }
 
-            measurePtrPtr = NULL;
-        }
+    virtual TransformFunction *createTransformFunction(ServerInterface &srvInterface)
+    {
+        return vt_createFuncObj(srvInterface.allocator, Pivot); 
+    }
 
-        if( columnNames != NULL ) 
-        {
-		    delete columnNames;
-		    columnNames = NULL;
-	    }
+};
 
-        if( measureTypePtrPtr != NULL )
-        {
-            for(int midx = 0; midx < measureCount; midx++)
-                delete measureTypePtrPtr[midx];
-            
-            delete[] measureTypePtrPtr;
-            measureTypePtrPtr = NULL;
-        }
-	}
+RegisterFactory(PivotFactory);
+
+
+// 2nd phase of PivotMultiPhase: for each partition of group keys, merge partial aggregates of columns from 1st phase into one wide row.
+// input: group keys as partition columns, column index, then partials of each method on each measure, 
+// and AVG is partial sum and count in 2 columns.
+class PivotMerge : public TransformFunction
+{
+private:
+    typedef void (*MergeFunc)(PartitionReader &input_reader, const VerticaType &partialType, size_t inputColumn, int idx, uint64 *columnSetBits, void *aggregates);
+    typedef void (*OutputFunc)(PartitionWriter &output_writer, const VerticaType &measureType, const uint64 *columnSetBits, const void *aggregates, 
+                               int columnsCount, const int *touchedColumns, int touchedCount, int cellBase, int outputBase, int outputStride);
+
+    GroupKeyCodec groupKeyCodec;
+    std::string groupKey;
+    int keyCount;
+    size_t indexColumn;
+    int columnsCount;
+    int aggregateCount;
 
-    inline void processValueInt(bool &bColumnSet, vint &measure, const vint value)
+    // for each aggregate [aggregateCount]
+    // note: use VerticaType** except VerticaType*, because there is no default constructor of class VerticaType for convenient initializing array. 
+    VerticaType** partialTypePtrPtr;
+    std::vector<size_t> partialColumns;
+    std::vector<MergeFunc> mergeFuncs;
+    std::vector<OutputFunc> outputFuncs;
+    std::vector<int> aggregateWordsCounts;
+
+    // accumulators of one merged row and touched columns, carved from one arena as Pivot does, 
+    // so that they are declared with Pivot and checked against maxMemory.
+    char* arenaPtr;
+    size_t arenaSize;
+    size_t arenaUsed;
+    int bitmapWordsCount;
+    void** aggregatePtrPtr;
+    // bitmap of each aggregate [aggregateCount * bitmapWordsCount]
+    uint64* columnSetBits;
+    uint64* touchedBits;
+    int* touchedColumns;
+    int touchedCount;
+
+    template <int METHOD>
+    static void mergeInt(PartitionReader &input_reader, const VerticaType &partialType, size_t inputColumn, int idx, uint64 *columnSetBits, void *aggregates)
     {
-        if ( !bColumnSet || (method == methodLAST) ) 
-        {
-            measure = value;
-            bColumnSet = true;
-        }
-        else if ( method == methodFIRST )
-        {
-            // skip
-        } 
-        else if ( (method == methodSUM) && (value != vint_null) ) 
+        Pivot::processValue<METHOD, vint>(columnSetBits, idx, ((vint*)aggregates)[idx], input_reader.getIntRef(inputColumn));
+    }
+
+    template <int METHOD>
+    static void mergeFloat(PartitionReader &input_reader, const VerticaType &partialType, size_t inputColumn, int idx, uint64 *columnSetBits, void *aggregates)
+    {
+        Pivot::processValue<METHOD, vfloat>(columnSetBits, idx, ((vfloat*)aggregates)[idx], input_reader.getFloatRef(inputColumn));
+    }
+
+    template <int METHOD>
+    static void mergeNumeric(PartitionReader &input_reader, const VerticaType &partialType, size_t inputColumn, int idx, uint64 *columnSetBits, void *aggregates)
+    {
+        const int wordsCount = Pivot::measureWords(partialType);
+        VNumeric aggregate((uint64*)aggregates + (size_t)idx * wordsCount, partialType.getNumericPrecision(), partialType.getNumericScale());
+        Pivot::processValueNumeric<METHOD>(columnSetBits, idx, aggregate, input_reader.getNumericPtr(inputColumn), wordsCount);
+    }
+
+    // SUM of numeric partials in one word as scaled int64 like Pivot, so that wraparound is checked on each add and precision at output
+    static void mergeScaledSum(PartitionReader &input_reader, const VerticaType &partialType, size_t inputColumn, int idx, uint64 *columnSetBits, void *aggregates)
+    {
+        // note: NULL of one word numeric is same bits as vint_null
+        const vint value = (vint)input_reader.getNumericPtr(inputColumn)->words[0];
+        if ( Pivot::isNullValue(value) )
+            return;
+
+        vint &aggregate = ((vint*)aggregates)[idx];
+        if ( Pivot::isColumnSet(columnSetBits, idx) )
+            Pivot::addScaled(partialType, aggregate, value);
+        else
         {
-            if  ( measure == vint_null )
-                measure = value;
-            else
-                measure += value;
+            aggregate = value;
+            Pivot::setColumn(columnSetBits, idx);
         }
     }
 
-    inline void processValueFloat(bool &bColumnSet, vfloat &measure, const vfloat value)
+    // partial AVG is sum in inputColumn and count in inputColumn + 1
+    static void mergeAverage(PartitionReader &input_reader, const VerticaType &partialType, size_t inputColumn, int idx, uint64 *columnSetBits, void *aggregates)
     {
-        if (!bColumnSet || (method == methodLAST)) 
+        const vint count = input_reader.getIntRef(inputColumn + 1);
+        if (count == vint_null || count <= 0)
+            return;
+
+        PivotAverage &average = ((PivotAverage*)aggregates)[idx];
+        if ( Pivot::isColumnSet(columnSetBits, idx) )
         {
-            measure = value;
-            bColumnSet = true;
+            average.sum += input_reader.getFloatRef(inputColumn);
+            average.count += count;
         }
-        else if ( method == methodFIRST )
-        {
-            // skip
-        } 
-        else if ( (method == methodSUM) && (!vfloatIsNull(value)) ) 
+        else
         {
-            if ( vfloatIsNull(measure) )
-                measure = value;
-            else
-                measure += value;
+            average.sum = input_reader.getFloatRef(inputColumn);
+            average.count = count;
+            Pivot::setColumn(columnSetBits, idx);
         }
     }
 
-    inline void processValueNumeric(bool &bColumnSet, VNumeric &measure, const VNumeric *valuePtr)
+    template <int METHOD>
+    static MergeFunc chooseMerge(const VerticaType &partialType)
     {
-        if (!bColumnSet || (method == methodLAST)) 
-        {
-            measure.copy(valuePtr);
-            bColumnSet = true;
-        }
-        else if ( method == methodFIRST )
-        {
-            // skip
-        } 
-        else if ( (method == methodSUM) && (!valuePtr->isNull()) ) 
+        if (partialType.isInt())
+            return mergeInt<METHOD>;
+        else if (partialType.isFloat())
+            return mergeFloat<METHOD>;
+        else
+            return mergeNumeric<METHOD>;
+    }
+
+    // layout of arena, called once to get size and once more to assign buffers
+    void layoutArena()
+    {
+        arenaUsed = 0;
+        aggregatePtrPtr = carvePivotArena<void*>(arenaPtr, arenaUsed, aggregateCount);
+        columnSetBits = carvePivotArena<uint64>(arenaPtr, arenaUsed, (size_t)aggregateCount * bitmapWordsCount);
+        touchedBits = carvePivotArena<uint64>(arenaPtr, arenaUsed, bitmapWordsCount);
+        touchedColumns = carvePivotArena<int>(arenaPtr, arenaUsed, columnsCount);
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
         {
-            if ( measure.isNull() )
-                measure.copy(valuePtr);
-            else 
-                measure.accumulate(valuePtr);
+            uint64* aggregatePtr = carvePivotArena<uint64>(arenaPtr, arenaUsed, (size_t)columnsCount * aggregateWordsCounts[aidx]);
+            if (arenaPtr != NULL)
+                aggregatePtrPtr[aidx] = (void *) aggregatePtr;
         }
     }
 
-    virtual void processPartition(ServerInterface &srvInterface,
-                                  PartitionReader &input_reader,
-                                  PartitionWriter &output_writer)
+public:
+    PivotMerge(): keyCount(0), indexColumn(0), columnsCount(0), aggregateCount(0), partialTypePtrPtr(NULL), 
+        arenaPtr(NULL), arenaSize(0), arenaUsed(0), bitmapWordsCount(0), aggregatePtrPtr(NULL), columnSetBits(NULL), touchedBits(NULL), touchedColumns(NULL), touchedCount(0)
     {
-        if (input_reader.getNumCols() != measureCount + 1)
-            vt_report_error(0, "Function need %zu arguments, but %zu provided", measureCount + 1, input_reader.getNumCols());
+    }
 
-        // re-init buffer
-        bool bColumnSet[measureCount][columnsCount];
-        for(int midx = 0; midx < measureCount; midx++)
+    // parse arguments and parameters, and size arena without allocating it, same as Pivot::configure.
+    void configure(ServerInterface &srvInterface, const SizedColumnTypes &input_types)
+    {
+        std::vector<size_t> keyColumns;
+        input_types.getPartitionByColumns(keyColumns);
+        std::vector<size_t> argumentColumns;
+        input_types.getArgumentColumns(argumentColumns);
+        keyCount = keyColumns.size();
+        groupKeyCodec.init(input_types, keyColumns);
+        indexColumn = argumentColumns[0];
+
+        // get parameters
+        ParamReader paramReader = srvInterface.getParamReader();
+        std::string method = DEFAULT_method;
+        if (paramReader.containsParameter("method"))
+            method = paramReader.getStringRef("method").str();
+        std::vector<int> methodIds;
+        std::vector<std::string> methodNames;
+        parsePivotMethods(method, methodIds, methodNames);
+        std::vector<std::string> columnKeys;
+        getPivotColumnKeys(paramReader, columnKeys);
+        if (getPivotOtherColumn(paramReader))
+            columnKeys.push_back(OTHER_COLUMN_name);
+        columnsCount = columnKeys.size();
+
+        // aggregates in order of partials, each measure has one partial for each method, AVG has 2.
+        std::vector<int> aggregateMethods;
+        for(size_t pidx = 1; pidx < argumentColumns.size(); pidx++)
         {
-            std::fill_n(bColumnSet[midx], columnsCount, false);
-            if ((*measureTypePtrPtr[midx]).isInt())
-                std::fill_n((vint*)measurePtrPtr[midx], columnsCount, vint_null);
-            else if ((*measureTypePtrPtr[midx]).isFloat())
-                std::fill_n((vfloat*)measurePtrPtr[midx], columnsCount, vfloat_null);
-            else if ((*measureTypePtrPtr[midx]).isNumeric())
-                for(int idx = 0; idx < columnsCount; idx++)
-                    ((VNumeric**)measurePtrPtr[midx])[idx]->setNull();
+            int methodId = methodIds[aggregateMethods.size() % methodIds.size()];
+            aggregateMethods.push_back(methodId);
+            partialColumns.push_back(argumentColumns[pidx]);
+            if (methodId == PIVOT_AVG)
+                pidx++;
         }
+        aggregateCount = aggregateMethods.size();
 
-        // SUM/FIRST/LAST operate on from 2nd parameter group by 1st parameter in each partition, considering NULL.
-        do {
-            // group by on 1st parameter 
-            int idx;
-            const VString& gby = input_reader.getStringRef(0);
-            std::map<std::string, int>::iterator i = columnNames->find(gby.str());
-            if( i != columnNames->end() )
-                idx = i->second;
-            else
-                idx = columnsCount + 1;
+        partialTypePtrPtr = new VerticaType*[aggregateCount];
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
+        {
+            partialTypePtrPtr[aidx] = new VerticaType(VUnspecOID, 0);
+            (*partialTypePtrPtr[aidx]) = input_types.getColumnType(partialColumns[aidx]);
+            const VerticaType &partialType = *partialTypePtrPtr[aidx];
 
-            // SUM/FIRST/LAST operate on from 2nd parameter 
-            if(idx >= 0 and idx < columnsCount) 
+            switch (aggregateMethods[aidx])
             {
-                for(int midx = 0; midx < measureCount; midx++)
+            case PIVOT_COUNT:
+                mergeFuncs.push_back(mergeInt<PIVOT_SUM>);
+                outputFuncs.push_back(Pivot::outputCount);
+                break;
+            case PIVOT_AVG:
+                mergeFuncs.push_back(mergeAverage);
+                outputFuncs.push_back(Pivot::outputAverage);
+                break;
+            case PIVOT_MIN:
+                mergeFuncs.push_back(chooseMerge<PIVOT_MIN>(partialType));
+                break;
+            case PIVOT_MAX:
+                mergeFuncs.push_back(chooseMerge<PIVOT_MAX>(partialType));
+                break;
+            default:
+                if (partialType.isNumeric() && Pivot::measureWords(partialType) == 1)
                 {
-                    if ((*measureTypePtrPtr[midx]).isInt()) 
-                        processValueInt(bColumnSet[midx][idx], ((vint*)measurePtrPtr[midx])[idx], input_reader.getIntRef(midx + 1));
-                    else if ((*measureTypePtrPtr[midx]).isFloat()) 
-                        processValueFloat(bColumnSet[midx][idx], ((vfloat*)measurePtrPtr[midx])[idx], input_reader.getFloatRef(midx + 1));
-                    else if ((*measureTypePtrPtr[midx]).isNumeric()) 
-                        processValueNumeric(bColumnSet[midx][idx], *(((VNumeric**)measurePtrPtr[midx])[idx]), input_reader.getNumericPtr(midx + 1));
+                    mergeFuncs.push_back(mergeScaledSum);
+                    outputFuncs.push_back(Pivot::outputScaledSum);
                 }
+                else
+                    mergeFuncs.push_back(chooseMerge<PIVOT_SUM>(partialType));
+                break;
             }
+            if (outputFuncs.size() <= (size_t)aidx)
+                outputFuncs.push_back(partialType.isInt()? Pivot::outputInt : (partialType.isFloat()? Pivot::outputFloat : Pivot::outputNumeric));
 
-        } while (input_reader.next());
+            aggregateWordsCounts.push_back((aggregateMethods[aidx] == PIVOT_AVG)? sizeof(PivotAverage) / sizeof(uint64) : Pivot::measureWords(partialType));
+        }
+        bitmapWordsCount = (columnsCount + 63) / 64;
+        layoutArena();
+        arenaSize = arenaUsed;
 
-        // output
-        // note: loop hurt performance. Even just loop 1 time, running processPartition 500M times with 80 columns need more 2 seconds.
-        if (measureCount == 1)
-        {
-            // note: pointer calculating also hurt performance. running processPartition 500M times with 80 columns need more 0.5 seconds.
-            const VerticaType& measureType = *measureTypePtrPtr[0];
-            const vint* measureIntPtr = (vint*)measurePtrPtr[0];
-            const vfloat* measureFloatPtr = (vfloat*)measurePtrPtr[0];
-            const VNumeric** measureNumPtrPtr = (const VNumeric**)measurePtrPtr[0];
-            for(int idx = 0; idx < columnsCount; idx++) 
-            {
-                if (measureType.isInt()) 
-                    output_writer.setInt(idx, measureIntPtr[idx]);
-                else if (measureType.isFloat())
-                    output_writer.setFloat(idx, measureFloatPtr[idx]);
-                else if (measureType.isNumeric()) 
-                    output_writer.getNumericRef(idx).copy(measureNumPtrPtr[idx]);
-            }
-         }
-        else
+        const vint maxMemory = getPivotMaxMemory(paramReader);
+        if (memoryBytes() > (size_t)maxMemory * 1024 * 1024)
+            vt_report_error(0, "PivotMultiPhase needs [%zu]MB memory to merge [%d] columns of [%d] aggregates, more than [%lld]MB of parameter [maxMemory], please reduce columns, measures or methods!", 
+                            (memoryBytes() + 1024 * 1024 - 1) / (1024 * 1024), columnsCount, aggregateCount, (long long)maxMemory);
+    }
+
+    // memory of an instance after configure
+    size_t memoryBytes() const
+    {
+        return arenaSize + PIVOT_ARENA_ALIGN;
+    }
+
+    virtual void setup(ServerInterface &srvInterface, const SizedColumnTypes &input_types)
+    {
+        configure(srvInterface, input_types);
+
+        arenaPtr = allocPivotArena(srvInterface, arenaSize);
+        layoutArena();
+        memset(columnSetBits, 0, sizeof(uint64) * aggregateCount * bitmapWordsCount);
+        memset(touchedBits, 0, sizeof(uint64) * bitmapWordsCount);
+        touchedCount = 0;
+    }
+
+    virtual void destroy(ServerInterface &srvInterface, const SizedColumnTypes &input_types)
+    {
+        release();
+    }
+
+    // free what configure and setup allocated, except arena, which is freed by srvInterface.allocator with this function instance
+    void release()
+    {
+        arenaPtr = NULL;
+        arenaSize = 0;
+        arenaUsed = 0;
+
+        if( partialTypePtrPtr != NULL )
         {
-            for(int idx = 0; idx < columnsCount; idx++) 
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                delete partialTypePtrPtr[aidx];
+            
+            delete[] partialTypePtrPtr;
+            partialTypePtrPtr = NULL;
+        }
+    }
+
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  PartitionReader &input_reader,
+                                  PartitionWriter &output_writer)
+    {
+        groupKeyCodec.encode(input_reader, groupKey);
+        do {
+            // note: a group without any matched row comes with NULL column index
+            const vint idx = input_reader.getIntRef(indexColumn);
+            if (idx == vint_null)
+                continue;
+            if (idx < 0 || idx >= columnsCount)
+                vt_report_error(0, "Column index [%lld] of partial is out of [%d] columns!", (long long)idx, columnsCount);
+
+            if (!Pivot::isColumnSet(touchedBits, idx))
             {
-                for(int midx = 0; midx < measureCount; midx++)
-                {
-                    if ((*measureTypePtrPtr[midx]).isInt()) 
-                        output_writer.setInt(idx * measureCount + midx, ((vint*)measurePtrPtr[midx])[idx]);
-                    else if ((*measureTypePtrPtr[midx]).isFloat())
-                        output_writer.setFloat(idx * measureCount + midx, ((vfloat*)measurePtrPtr[midx])[idx]);
-                    else if ((*measureTypePtrPtr[midx]).isNumeric()) 
-                        output_writer.getNumericRef(idx * measureCount + midx).copy(((VNumeric**)measurePtrPtr[midx])[idx]);
-                }
+                Pivot::setColumn(touchedBits, idx);
+                touchedColumns[touchedCount++] = idx;
             }
-        }
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                mergeFuncs[aidx](input_reader, *partialTypePtrPtr[aidx], partialColumns[aidx], idx, columnSetBits + aidx * bitmapWordsCount, aggregatePtrPtr[aidx]);
+        } while (input_reader.next());
 
+        // output: group keys, then for each column, each aggregate
+        groupKeyCodec.decode(output_writer, 0, groupKey.data());
+        for(int aidx = 0; aidx < aggregateCount; aidx++)
+            outputFuncs[aidx](output_writer, *partialTypePtrPtr[aidx], columnSetBits + aidx * bitmapWordsCount, aggregatePtrPtr[aidx], 
+                              columnsCount, touchedColumns, touchedCount, 0, keyCount + aidx, aggregateCount);
         output_writer.next();
+
+        // re-init buffer for next partition
+        for(int tidx = 0; tidx < touchedCount; tidx++) 
+        {
+            int word = touchedColumns[tidx] >> 6;
+            touchedBits[word] = 0;
+            for(int aidx = 0; aidx < aggregateCount; aidx++)
+                columnSetBits[aidx * bitmapWordsCount + word] = 0;
+        }
+        touchedCount = 0;
     }
 };
 
 
-class PivotFactory : public TransformFunctionFactory
+// 1st phase of PivotMultiPhase: Pivot in hash mode on local data, emitting partial aggregates of each column of each group.
+class PivotPartialPhase : public TransformFunctionPhase
 {
-    virtual void getPrototype(ServerInterface &srvInterface, ColumnTypes &input_types, ColumnTypes &returnType)
-    {
-        // get parameters
-        ParamReader paramReader = srvInterface.getParamReader();
-
-        input_types.addAny();
-        
-        // Note: need not add any type to returnType. empty returnType means any columnsFilter and types!
-    }
-
     virtual void getReturnType(ServerInterface &srvInterface, const SizedColumnTypes &input_types, SizedColumnTypes &output_types)
     {
-        // check arguments
-        int measureCount = input_types.getColumnCount() - 1;
-        if ( measureCount < 1 ) 
-            vt_report_error(0, "There should be 2 or more arguments, but [%zu] arguments are provided!", input_types.getColumnCount());
-        VerticaType columnsFilterType = input_types.getColumnType(0);
-        if ( ! columnsFilterType.isStringType() )
-            vt_report_error(0, "The 1st argument should be string, but type[%s] is provided!", columnsFilterType.getTypeStr());
+        int keyCount, measureBase, measureCount;
+        std::vector<int> methodIds;
+        std::vector<std::string> methodNames;
+        std::vector<std::string> columnKeys;
+        getPivotSignature(srvInterface, input_types, keyCount, measureBase, measureCount, methodIds, methodNames, columnKeys);
+        checkPivotPartialMethods(keyCount, methodIds);
+        checkPivotNumericMeasures(input_types, measureBase, measureCount, "PivotMultiPhase");
 
-        VerticaType** measureTypePtrPtr = new VerticaType*[measureCount];
+        // output: group keys as partition of 2nd phase, column index, then partials of each measure, each method
+        for(int kidx = 0; kidx < keyCount; kidx++)
+            output_types.addPartitionColumn(input_types.getColumnType(kidx), input_types.getColumnName(kidx));
+        output_types.addInt("pivot_column");
         for(int midx = 0; midx < measureCount; midx++)
         {
-            measureTypePtrPtr[midx] = new VerticaType(VUnspecOID, 0);
-            (*measureTypePtrPtr[midx]) = input_types.getColumnType(midx+1);
-            if ( !(*measureTypePtrPtr[midx]).isInt() && !(*measureTypePtrPtr[midx]).isFloat() && !(*measureTypePtrPtr[midx]).isNumeric() ) 
+            for(size_t kidx = 0; kidx < methodIds.size(); kidx++)
             {
-                for(; midx>=0; midx--)
-                    delete measureTypePtrPtr[midx];
-
-                delete[] measureTypePtrPtr;
-                measureTypePtrPtr = NULL;
-                vt_report_error(0, "The [%zu] argument should be int, float or numeric, but type[%s] is provided!", measureCount + 1, input_types.getColumnType(midx+1).getTypeStr());
+                std::string partialName = pivotColumnName("partial", midx, methodNames[kidx], true);
+                if (methodIds[kidx] == PIVOT_COUNT)
+                    output_types.addInt(partialName);
+                else if (methodIds[kidx] == PIVOT_AVG)
+                {
+                    output_types.addFloat(partialName + "_sum");
+                    output_types.addInt(partialName + "_count");
+                }
+                else
+                    output_types.addArg(input_types.getColumnType(measureBase+midx), partialName);
             }
         }
+    }
+
+    virtual TransformFunction *createTransformFunction(ServerInterface &srvInterface)
+    {
+        return vt_createFuncObj(srvInterface.allocator, Pivot, true); 
+    }
+};
+
+
+// 2nd phase of PivotMultiPhase
+class PivotMergePhase : public TransformFunctionPhase
+{
+    virtual void getReturnType(ServerInterface &srvInterface, const SizedColumnTypes &input_types, SizedColumnTypes &output_types)
+    {
+        std::vector<size_t> keyColumns;
+        input_types.getPartitionByColumns(keyColumns);
+        std::vector<size_t> argumentColumns;
+        input_types.getArgumentColumns(argumentColumns);
 
         // get parameters
         ParamReader paramReader = srvInterface.getParamReader();
         std::string method = DEFAULT_method;
         if (paramReader.containsParameter("method"))
             method = paramReader.getStringRef("method").str();
-            std::transform(method.begin(), method.end(), method.begin(), ::toupper);
-        std::string separator = DEFAULT_separator;
-        if (paramReader.containsParameter("separator"))
-            separator = paramReader.getStringRef("separator").str();
-        std::string columnsFilter = "";
-        if (paramReader.containsParameter("columnsFilter"))
-            columnsFilter = paramReader.getStringRef("columnsFilter").str();
-        else
-            vt_report_error(0, "Function need at least parameter [columnsFilter]!");
+        std::vector<int> methodIds;
+        std::vector<std::string> methodNames;
+        parsePivotMethods(method, methodIds, methodNames);
+        std::vector<std::string> columnKeys;
+        getPivotColumnKeys(paramReader, columnKeys);
+        if (getPivotOtherColumn(paramReader))
+            columnKeys.push_back(OTHER_COLUMN_name);
+
+        // partial columns of each measure
+        size_t partialsCount = 0;
+        std::vector<size_t> partialOffsets;
+        for(size_t kidx = 0; kidx < methodIds.size(); kidx++)
+        {
+            partialOffsets.push_back(partialsCount);
+            partialsCount += (methodIds[kidx] == PIVOT_AVG)? 2 : 1;
+        }
+        int measureCount = (argumentColumns.size() - 1) / partialsCount;
 
-        // output 
-        istringstream ss(columnsFilter);
-        const char delim = separator.c_str()[0];
-        std::string token;
-        while (getline(ss, token, delim)) 
+        // output: group keys, then for each column, each measure, each method
+        for(size_t kidx = 0; kidx < keyColumns.size(); kidx++)
+            output_types.addArg(input_types.getColumnType(keyColumns[kidx]), input_types.getColumnName(keyColumns[kidx]));
+        for(size_t idx = 0; idx < columnKeys.size(); idx++) 
         {
             for(int midx = 0; midx < measureCount; midx++)
             {
-                std::stringstream columnName;
-                columnName << token;
-                if (midx > 0) 
-                    columnName << "_" << midx;
-
-                if ((*measureTypePtrPtr[midx]).isInt())
-                    output_types.addInt(columnName.str());
-                else if ((*measureTypePtrPtr[midx]).isFloat())
-                    output_types.addFloat(columnName.str());
-                else if ((*measureTypePtrPtr[midx]).isNumeric())
-                    output_types.addNumeric((*measureTypePtrPtr[midx]).getNumericPrecision(), (*measureTypePtrPtr[midx]).getNumericScale(), columnName.str());
-                else
-                    vt_report_error(0, "Unkown type of 2 arguments: %s !", (*measureTypePtrPtr[midx]).getTypeStr());
+                for(size_t kidx = 0; kidx < methodIds.size(); kidx++)
+                {
+                    const VerticaType &partialType = input_types.getColumnType(argumentColumns[1 + midx * partialsCount + partialOffsets[kidx]]);
+                    addPivotOutputType(output_types, partialType, methodIds[kidx], 
+                                       pivotColumnName(columnKeys[idx], midx, methodNames[kidx], methodIds.size() > 1));
+                }
             }
         }
     }
 
-    // Defines the parameters for this UDSF. Works similarly to defining
-    // arguments and return types.
+    virtual TransformFunction *createTransformFunction(ServerInterface &srvInterface)
+    {
+        return vt_createFuncObj(srvInterface.allocator, PivotMerge); 
+    }
+};
+
+
+// Pivot in 2 phases: 1st phase aggregates rows of many groups by hashing on each node locally, 
+// and only partial aggregates of each column of each group are sent to 2nd phase, which merges them into wide rows. 
+class PivotMultiPhaseFactory : public MultiPhaseTransformFunctionFactory
+{
+private:
+    PivotPartialPhase partialPhase;
+    PivotMergePhase mergePhase;
+
+public:
+    virtual void getPrototype(ServerInterface &srvInterface, ColumnTypes &input_types, ColumnTypes &returnType)
+    {
+        input_types.addAny();
+    }
+
     virtual void getParameterType(ServerInterface &srvInterface, SizedColumnTypes &parameterTypes) 
     {
-        parameterTypes.addVarchar(65000, "columnsFilter");
-        //parameter: separator string for columnNames, default value is ','.
-        parameterTypes.addVarchar(1, "separator");
-        parameterTypes.addVarchar(10, "method");
+        addPivotParameterTypes(parameterTypes);
     }
 
+    // note: the larger instance of both phases is declared, it's usually 1st phase, whose accumulators of maxGroups groups are larger than one merged row of 2nd phase.
+    virtual void getPerInstanceResources(ServerInterface &srvInterface, VResources &res, const SizedColumnTypes &input_types)
+    {
+        const vint declaredMemory = res.scratchMemory;
+        getPivotPerInstanceResources(srvInterface, res, input_types, true);
 
-    virtual TransformFunction *createTransformFunction(ServerInterface &srvInterface)
+        // 2nd phase gets output of 1st phase as input
+        SizedColumnTypes partialTypes;
+        TransformFunctionPhase &phase = partialPhase;
+        phase.getReturnType(srvInterface, input_types, partialTypes);
+        PivotMerge merge;
+        try
+        {
+            merge.configure(srvInterface, partialTypes);
+        }
+        catch (...)
+        {
+            merge.release();
+            throw;
+        }
+        res.scratchMemory = std::max(res.scratchMemory, declaredMemory + (vint)merge.memoryBytes());
+        merge.release();
+    }
+
+    virtual void getPhases(ServerInterface &srvInterface, std::vector<TransformFunctionPhase *> &phases)
     {
-        return vt_createFuncObj(srvInterface.allocator, Pivot); 
+        partialPhase.setPrepass();
+        phases.push_back(&partialPhase);
+        phases.push_back(&mergePhase);
     }
+};
+
+RegisterFactory(PivotMultiPhaseFactory);
 
+
+// extract text of a cell from packed output of pivot, cell is 1-based position of the column in default output format without group keys.
+// note: result is varchar, so that it can be cast to type of the cell in SQL.
+class PivotCell : public ScalarFunction
+{
+public:
+    virtual void processBlock(ServerInterface &srvInterface,
+                              BlockReader &arg_reader,
+                              BlockWriter &res_writer)
+    {
+        char text[PIVOTCELL_LENGTH + 1];
+        do {
+            const VString &packed = arg_reader.getStringRef(0);
+            const vint cell = arg_reader.getIntRef(1);
+            size_t textLength = 0;
+            if (packed.isNull() || cell == vint_null || !PivotPacked::formatCell(packed.data(), packed.length(), cell - 1, text, sizeof(text), textLength))
+                res_writer.getStringRef().setNull();
+            else
+                res_writer.getStringRef().copy(text, textLength);
+            res_writer.next();
+        } while (arg_reader.next());
+    }
 };
 
-RegisterFactory(PivotFactory);
 
+class PivotCellFactory : public ScalarFunctionFactory
+{
+    virtual void getPrototype(ServerInterface &srvInterface, ColumnTypes &argTypes, ColumnTypes &returnType)
+    {
+        argTypes.addAny();
+    }
+
+    virtual void getReturnType(ServerInterface &srvInterface, const SizedColumnTypes &argTypes, SizedColumnTypes &returnType)
+    {
+        if (argTypes.getColumnCount() != 2)
+            vt_report_error(0, "There should be 2 arguments, but [%zu] arguments are provided!", argTypes.getColumnCount());
+        if (!argTypes.getColumnType(0).isVarbinary() && !argTypes.getColumnType(0).isLongVarbinary())
+            vt_report_error(0, "The 1st argument should be packed output of pivot, but type[%s] is provided!", argTypes.getColumnType(0).getTypeStr());
+        if (!argTypes.getColumnType(1).isInt())
+            vt_report_error(0, "The 2nd argument should be int, but type[%s] is provided!", argTypes.getColumnType(1).getTypeStr());
+
+        returnType.addVarchar(PIVOTCELL_LENGTH, "value");
+    }
+
+    virtual ScalarFunction *createScalarFunction(ServerInterface &srvInterface)
+    {
+        return vt_createFuncObj(srvInterface.allocator, PivotCell); 
+    }
+};
+
+RegisterFactory(PivotCellFactory);
@@ -0,0 +1,93 @@
+/* Copyright (c) DingQiang Liu(dingqiangliu@gmail.com), 2012 - 2017 -*- C++ -*- */
+/*
+ * Description: optional counters and timers on hot path of pivot/unpivot, enabled by parameter profile=true and logged when function instance is destroyed
+ */
+
+#ifndef PIVOT_PROFILE_H
+#define PIVOT_PROFILE_H
+
+#include "Vertica.h"
+#include <time.h>
+
+using namespace Vertica;
+
+
+// CPU cycles on x86, or nanoseconds on other platforms
+inline uint64 readProfileCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+
+// note: counters are added once per block or partition whether enabled or not, which costs nothing measurable,
+// but timers are only read when enabled, once per block of rows rather than each row.
+struct PivotProfile
+{
+    bool enabled;
+
+    vint partitions;
+    vint rowsRead;
+    vint rowsMatched;
+    vint numericAccumulations;
+    vint outputRows;
+    vint outputCells;
+
+    uint64 lookupCycles;
+    uint64 accumulateCycles;
+    uint64 outputCycles;
+
+    PivotProfile(): enabled(false), partitions(0), rowsRead(0), rowsMatched(0), numericAccumulations(0), outputRows(0), outputCells(0),
+        lookupCycles(0), accumulateCycles(0), outputCycles(0)
+    {
+    }
+
+    // start timing from now
+    inline void start(uint64 &mark) const
+    {
+        if (enabled)
+            mark = readProfileCycles();
+    }
+
+    // add cycles since mark to phase cycles, and move mark to now
+    inline void lap(uint64 &cycles, uint64 &mark) const
+    {
+        if (enabled)
+        {
+            uint64 now = readProfileCycles();
+            cycles += now - mark;
+            mark = now;
+        }
+    }
+
+    void log(ServerInterface &srvInterface, const char *functionName) const
+    {
+        if (!enabled)
+            return;
+
+        srvInterface.log("%s profile: partitions=%lld, rowsRead=%lld, rowsMatched=%lld, rowsUnmatched=%lld, numericAccumulations=%lld, outputRows=%lld, outputCells=%lld",
+                         functionName, (long long)partitions, (long long)rowsRead, (long long)rowsMatched, (long long)(rowsRead - rowsMatched),
+                         (long long)numericAccumulations, (long long)outputRows, (long long)outputCells);
+        srvInterface.log("%s profile: lookupCycles=%llu, accumulateCycles=%llu, outputCycles=%llu, cyclesPerRow=%.1f",
+                         functionName, (unsigned long long)lookupCycles, (unsigned long long)accumulateCycles, (unsigned long long)outputCycles,
+                         (rowsRead > 0)? (double)(lookupCycles + accumulateCycles + outputCycles) / rowsRead : 0.0);
+    }
+
+    // log of functions which only output rows as they read, without lookup or accumulation, so only counters and timer they measure are printed.
+    void logOutput(ServerInterface &srvInterface, const char *functionName) const
+    {
+        if (!enabled)
+            return;
+
+        srvInterface.log("%s profile: partitions=%lld, rowsRead=%lld, outputRows=%lld, outputCells=%lld, outputCycles=%llu, cyclesPerRow=%.1f",
+                         functionName, (long long)partitions, (long long)rowsRead, (long long)outputRows, (long long)outputCells,
+                         (unsigned long long)outputCycles, (rowsRead > 0)? (double)outputCycles / rowsRead : 0.0);
+    }
+};
+
+#endif // PIVOT_PROFILE_H
@@ -5,43 +5,507 @@
  * Create Date: Dec 17, 2017
  */
 #include "Vertica.h"
+#include "profile.h"
+#include "numeric.h"
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
 
 using namespace Vertica;
 using namespace std;
 
 #define DEFAULT_separator ","
+// max length of varchar output
+#define MAX_VARCHAR_LENGTH 65000
+
+
+// types of measure values supported
+inline bool isUnPivotStringType(const VerticaType &measureType)
+{
+    return measureType.isChar() || measureType.isVarchar() || measureType.isLongVarchar();
+}
+
+inline bool isUnPivotSupportedType(const VerticaType &measureType)
+{
+    return measureType.isInt() || measureType.isFloat() || measureType.isDate() || measureType.isNumeric() 
+        || measureType.isTimestamp() || measureType.isTimestampTz() || measureType.isBool() || isUnPivotStringType(measureType);
+}
+
+// get size of argument groups from parameter groupSize, default value is 1.
+inline int getUnPivotGroupSize(ParamReader &paramReader, const SizedColumnTypes &input_types)
+{
+    vint groupSize = 1;
+    if (paramReader.containsParameter("groupSize"))
+        groupSize = paramReader.getIntRef("groupSize");
+    if (groupSize < 1 || input_types.getColumnCount() % groupSize != 0)
+        vt_report_error(0, "Parameter [groupSize] should be positive and divide count of arguments [%zu], but [%lld] is provided!", 
+                        input_types.getColumnCount(), (long long)groupSize);
+    return groupSize;
+}
+
+// check measure arguments at same position of each group are same type, except strings can be any width
+inline void checkUnPivotArguments(const SizedColumnTypes &input_types, int groupSize)
+{
+    int argumentsCount = input_types.getColumnCount();
+    if ( argumentsCount  < 1 ) 
+        vt_report_error(0, "There should be more than 1 arguments, but [%zu] arguments are provided!", input_types.getColumnCount());
+
+    for(int idx = 0; idx < argumentsCount; idx++) 
+    {
+        const VerticaType &measureType = input_types.getColumnType(idx % groupSize);
+        const VerticaType &measureTypeOther = input_types.getColumnType(idx);
+        if ( idx < groupSize && !isUnPivotSupportedType(measureType) )
+            vt_report_error(0, "Unkown type of arguments: %s !", measureType.getTypeStr());
+        if ( isUnPivotStringType(measureType)? !isUnPivotStringType(measureTypeOther) : (measureTypeOther != measureType) )
+            vt_report_error(0, "All type of arguments should same, but the [%d] argument is type[%s] and the [%d] is type[%s]!", 
+                            idx + 1, measureTypeOther.getTypeStr(), idx % groupSize + 1, measureType.getTypeStr());
+    }
+}
+
+// add output type of value at position of groups, it's wide enough for all arguments at this position if it's string.
+inline void addUnPivotValueType(SizedColumnTypes &output_types, const SizedColumnTypes &input_types, int position, int groupSize, const std::string &name)
+{
+    const VerticaType &measureType = input_types.getColumnType(position);
+    if (measureType.isInt()) 
+        output_types.addInt(name);
+    else if (measureType.isFloat()) 
+        output_types.addFloat(name);
+    else if (measureType.isDate())
+        output_types.addDate(name);
+    else if (measureType.isNumeric()) 
+        output_types.addNumeric(measureType.getNumericPrecision(), measureType.getNumericScale(), name);
+    else if (measureType.isTimestamp() || measureType.isTimestampTz())
+        output_types.addArg(measureType, name);
+    else if (measureType.isBool())
+        output_types.addBool(name);
+    else
+    {
+        // note: output is wide enough for all arguments, long varchar if any is.
+        int valueLength = 1;
+        bool isLongVarchar = false;
+        for(size_t idx = position; idx < input_types.getColumnCount(); idx += groupSize) 
+        {
+            valueLength = std::max(valueLength, (int)input_types.getColumnType(idx).getStringLength());
+            isLongVarchar = isLongVarchar || input_types.getColumnType(idx).isLongVarchar();
+        }
+        if (isLongVarchar)
+            output_types.addLongVarchar(valueLength, name);
+        else
+            output_types.addVarchar(std::min(valueLength, MAX_VARCHAR_LENGTH), name);
+    }
+}
+
+// operators of predicate on measure values
+enum PredicateOperator
+{
+    OPERATOR_EQ,
+    OPERATOR_NE,
+    OPERATOR_LT,
+    OPERATOR_LE,
+    OPERATOR_GT,
+    OPERATOR_GE
+};
+
+// simple predicate such as '<> 0' or '>= 10.5', literal is converted to type of measures once.
+struct UnPivotPredicate
+{
+    int op;
+    vint intValue;
+    vfloat floatValue;
+    // numeric literal as words of measure type rounded down, and whether digits beyond scale are dropped
+    std::vector<uint64> numericWords;
+    bool numericInexact;
+    vbool boolValue;
+    std::string stringValue;
+
+    inline bool matches(int compared) const
+    {
+        switch (op)
+        {
+        case OPERATOR_EQ: return compared == 0;
+        case OPERATOR_NE: return compared != 0;
+        case OPERATOR_LT: return compared < 0;
+        case OPERATOR_LE: return compared <= 0;
+        case OPERATOR_GT: return compared > 0;
+        default: return compared >= 0;
+        }
+    }
+};
+
+// parse predicate in format 'operator literal', operator is one of =, <>, !=, <, <=, >, >=, string literal can be quoted by '.
+inline void parseUnPivotPredicate(const std::string &text, const VerticaType &measureType, UnPivotPredicate &predicate)
+{
+    static const char* operators[] = {"<>", "!=", "<=", ">=", "=", "<", ">"};
+    static const int operatorIds[] = {OPERATOR_NE, OPERATOR_NE, OPERATOR_LE, OPERATOR_GE, OPERATOR_EQ, OPERATOR_LT, OPERATOR_GT};
+
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        vt_report_error(0, "Parameter [predicate] should not be empty!");
+    int opIdx = -1;
+    for(int idx = 0; idx < (int)(sizeof(operatorIds) / sizeof(operatorIds[0])) && opIdx < 0; idx++)
+    {
+        if (text.compare(begin, strlen(operators[idx]), operators[idx]) == 0)
+            opIdx = idx;
+    }
+    if (opIdx < 0)
+        vt_report_error(0, "Predicate [%s] should start with one of operators =, <>, !=, <, <=, >, >=!", text.c_str());
+    predicate.op = operatorIds[opIdx];
+
+    std::string literal = text.substr(begin + strlen(operators[opIdx]));
+    size_t first = literal.find_first_not_of(" \t"), last = literal.find_last_not_of(" \t");
+    literal = (first == std::string::npos)? "" : literal.substr(first, last - first + 1);
+    if (literal.length() >= 2 && literal[0] == '\'' && literal[literal.length() - 1] == '\'')
+        literal = literal.substr(1, literal.length() - 2);
+
+    char* end = NULL;
+    if (measureType.isInt())
+    {
+        predicate.intValue = strtoll(literal.c_str(), &end, 10);
+        if (literal.empty() || *end != '\0')
+            vt_report_error(0, "Literal [%s] of predicate should be integer!", literal.c_str());
+    }
+    else if (measureType.isFloat())
+    {
+        predicate.floatValue = strtod(literal.c_str(), &end);
+        if (literal.empty() || *end != '\0')
+            vt_report_error(0, "Literal [%s] of predicate should be number!", literal.c_str());
+    }
+    else if (measureType.isNumeric())
+    {
+        predicate.numericWords.assign(measureType.getNumericPrecision() / 19 + 1, 0);
+        if (!parseNumericWords(literal, measureType.getNumericPrecision(), measureType.getNumericScale(), 
+                               &predicate.numericWords[0], predicate.numericWords.size(), predicate.numericInexact))
+            vt_report_error(0, "Literal [%s] of predicate should be number within type[Numeric(%d,%d)]!", 
+                            literal.c_str(), measureType.getNumericPrecision(), measureType.getNumericScale());
+    }
+    else if (measureType.isBool())
+    {
+        if (literal == "true" || literal == "t")
+            predicate.boolValue = vbool_true;
+        else if (literal == "false" || literal == "f")
+            predicate.boolValue = vbool_false;
+        else
+            vt_report_error(0, "Literal [%s] of predicate should be true or false!", literal.c_str());
+    }
+    else if (isUnPivotStringType(measureType))
+        predicate.stringValue = literal;
+    else
+        vt_report_error(0, "Parameter [predicate] is not supported on type[%s]!", measureType.getTypeStr());
+}
+
+// copiers of each type from input column to output column, chosen once in setup.
+// note: date, timestamp and timestamptz are all 8 bytes integer as int.
+struct IntValue
+{
+    static inline void copy(PartitionReader &input_reader, size_t inputColumn, PartitionWriter &output_writer, size_t outputColumn)
+    {
+        output_writer.setInt(outputColumn, input_reader.getIntRef(inputColumn));
+    }
+
+    static inline bool isNull(PartitionReader &input_reader, size_t inputColumn)
+    {
+        return input_reader.getIntRef(inputColumn) == vint_null;
+    }
+
+    static inline int compare(PartitionReader &input_reader, size_t inputColumn, const UnPivotPredicate &predicate)
+    {
+        const vint value = input_reader.getIntRef(inputColumn);
+        return (value > predicate.intValue) - (value < predicate.intValue);
+    }
+};
+
+struct FloatValue
+{
+    static inline void copy(PartitionReader &input_reader, size_t inputColumn, PartitionWriter &output_writer, size_t outputColumn)
+    {
+        output_writer.setFloat(outputColumn, input_reader.getFloatRef(inputColumn));
+    }
+
+    static inline bool isNull(PartitionReader &input_reader, size_t inputColumn)
+    {
+        return vfloatIsNull(input_reader.getFloatRef(inputColumn));
+    }
+
+    static inline int compare(PartitionReader &input_reader, size_t inputColumn, const UnPivotPredicate &predicate)
+    {
+        const vfloat value = input_reader.getFloatRef(inputColumn);
+        return (value > predicate.floatValue) - (value < predicate.floatValue);
+    }
+};
+
+struct BoolValue
+{
+    static inline void copy(PartitionReader &input_reader, size_t inputColumn, PartitionWriter &output_writer, size_t outputColumn)
+    {
+        output_writer.setBool(outputColumn, input_reader.getBoolRef(inputColumn));
+    }
+
+    static inline bool isNull(PartitionReader &input_reader, size_t inputColumn)
+    {
+        return input_reader.getBoolRef(inputColumn) == vbool_null;
+    }
+
+    static inline int compare(PartitionReader &input_reader, size_t inputColumn, const UnPivotPredicate &predicate)
+    {
+        const vbool value = input_reader.getBoolRef(inputColumn);
+        return (value > predicate.boolValue) - (value < predicate.boolValue);
+    }
+};
+
+struct NumericValue
+{
+    static inline void copy(PartitionReader &input_reader, size_t inputColumn, PartitionWriter &output_writer, size_t outputColumn)
+    {
+        output_writer.getNumericRef(outputColumn).copy(input_reader.getNumericPtr(inputColumn));
+    }
+
+    static inline bool isNull(PartitionReader &input_reader, size_t inputColumn)
+    {
+        return input_reader.getNumericPtr(inputColumn)->isNull();
+    }
+
+    // note: numeric is compared on its words with literal of same scale, if literal is inexact, it is a bit larger than its words.
+    static inline int compare(PartitionReader &input_reader, size_t inputColumn, const UnPivotPredicate &predicate)
+    {
+        const int compared = compareNumericWords(input_reader.getNumericPtr(inputColumn)->words, &predicate.numericWords[0], predicate.numericWords.size());
+        return (compared == 0 && predicate.numericInexact)? -1 : compared;
+    }
+};
+
+struct StringValue
+{
+    static inline void copy(PartitionReader &input_reader, size_t inputColumn, PartitionWriter &output_writer, size_t outputColumn)
+    {
+        output_writer.getStringRef(outputColumn).copy(&input_reader.getStringRef(inputColumn));
+    }
+
+    static inline bool isNull(PartitionReader &input_reader, size_t inputColumn)
+    {
+        return input_reader.getStringRef(inputColumn).isNull();
+    }
+
+    static inline int compare(PartitionReader &input_reader, size_t inputColumn, const UnPivotPredicate &predicate)
+    {
+        const VString &value = input_reader.getStringRef(inputColumn);
+        const size_t length = std::min((size_t)value.length(), predicate.stringValue.length());
+        int compared = memcmp(value.data(), predicate.stringValue.data(), length);
+        if (compared == 0)
+            compared = ((size_t)value.length() > predicate.stringValue.length()) - ((size_t)value.length() < predicate.stringValue.length());
+        return compared;
+    }
+};
+
+
+// filters of measure values before output
+enum UnPivotFilter
+{
+    FILTER_NONE,
+    FILTER_NULLS,
+    FILTER_PREDICATE
+};
 
 
 class UnPivot : public TransformFunction
 {
 private:
+    typedef void (UnPivot::*UnPivotRowsFunc)(PartitionReader &input_reader, PartitionWriter &output_writer);
+    typedef void (*CopyFunc)(PartitionReader &input_reader, size_t inputColumn, PartitionWriter &output_writer, size_t outputColumn);
+    typedef bool (*IsNullFunc)(PartitionReader &input_reader, size_t inputColumn);
+    typedef int (*CompareFunc)(PartitionReader &input_reader, size_t inputColumn, const UnPivotPredicate &predicate);
+
     VerticaType measureType;
+    // count of measure names, each name is for a group of groupSize arguments, which are output in one row.
 	int measureNamesCount;
+    int groupSize;
+    // functions of value at each position of groups [groupSize], chosen in setup.
+    std::vector<CopyFunc> copyFuncs;
+    std::vector<IsNullFunc> isNullFuncs;
+    CompareFunc compareFunc;
+    // note: names are prepared once with their lengths, so each output row only copies length-bounded bytes without strlen.
     std::string* columnNames;
+    // output 1-based measure index instead of measure name, so that no string is copied for each output row.
+    bool measureIndex;
+    // skip NULL values or values not matching predicate, so that output only has rows of real data.
+    int filter;
+    UnPivotPredicate predicate;
+    // loop of rows specialized for type of measures, measureIndex and filter, chosen once in setup, so that there is no branch for each cell.
+    UnPivotRowsFunc unpivotRowsFunc;
+    // counters and timers of hot path, logged in destroy with parameter profile=true
+    PivotProfile profile;
+
+    template <class Value, bool MEASURE_INDEX, int FILTER>
+    void unpivotRows(PartitionReader &input_reader, PartitionWriter &output_writer)
+    {
+        vint rowsRead = 0, outputRows = 0;
+        do 
+        {
+            rowsRead++;
+            for(int idx = 0; idx < measureNamesCount; idx++) 
+            {
+                // note: as SQL, NULL never matches any predicate
+                if (FILTER != FILTER_NONE && Value::isNull(input_reader, idx))
+                    continue;
+                if (FILTER == FILTER_PREDICATE && !predicate.matches(Value::compare(input_reader, idx, predicate)))
+                    continue;
+
+                if (MEASURE_INDEX)
+                    output_writer.setInt(0, idx + 1);
+                else
+                    output_writer.getStringRef(0).copy(columnNames[idx].data(), columnNames[idx].length());
+
+                Value::copy(input_reader, idx, output_writer, 1);
+
+                output_writer.next();
+                outputRows++;
+            }
+        } while (input_reader.next());
+        profile.rowsRead += rowsRead;
+        profile.outputRows += outputRows;
+    }
+
+    // loop of rows for groups, each value is copied by function of its position.
+    // note: with includeNulls=false a group is skipped only if all its values are NULL, predicate is on 1st value of group.
+    template <bool MEASURE_INDEX, int FILTER>
+    void unpivotGroups(PartitionReader &input_reader, PartitionWriter &output_writer)
+    {
+        vint rowsRead = 0, outputRows = 0;
+        do 
+        {
+            rowsRead++;
+            for(int idx = 0; idx < measureNamesCount; idx++) 
+            {
+                const size_t base = idx * groupSize;
+                if (FILTER == FILTER_NULLS)
+                {
+                    bool isNull = true;
+                    for(int position = 0; position < groupSize && isNull; position++)
+                        isNull = isNullFuncs[position](input_reader, base + position);
+                    if (isNull)
+                        continue;
+                }
+                if (FILTER == FILTER_PREDICATE && (isNullFuncs[0](input_reader, base) || !predicate.matches(compareFunc(input_reader, base, predicate))))
+                    continue;
+
+                if (MEASURE_INDEX)
+                    output_writer.setInt(0, idx + 1);
+                else
+                    output_writer.getStringRef(0).copy(columnNames[idx].data(), columnNames[idx].length());
+
+                for(int position = 0; position < groupSize; position++)
+                    copyFuncs[position](input_reader, base + position, output_writer, 1 + position);
+
+                output_writer.next();
+                outputRows++;
+            }
+        } while (input_reader.next());
+        profile.rowsRead += rowsRead;
+        profile.outputRows += outputRows;
+    }
+
+    template <bool MEASURE_INDEX>
+    UnPivotRowsFunc chooseFilterGroups()
+    {
+        if (filter == FILTER_PREDICATE)
+            return &UnPivot::unpivotGroups<MEASURE_INDEX, FILTER_PREDICATE>;
+        else if (filter == FILTER_NULLS)
+            return &UnPivot::unpivotGroups<MEASURE_INDEX, FILTER_NULLS>;
+        else
+            return &UnPivot::unpivotGroups<MEASURE_INDEX, FILTER_NONE>;
+    }
+
+    template <class Value>
+    void addValueFuncs()
+    {
+        copyFuncs.push_back(Value::copy);
+        isNullFuncs.push_back(Value::isNull);
+        if (compareFunc == NULL)
+            compareFunc = Value::compare;
+    }
+
+    template <class Value, bool MEASURE_INDEX>
+    UnPivotRowsFunc chooseFilterRows()
+    {
+        if (filter == FILTER_PREDICATE)
+            return &UnPivot::unpivotRows<Value, MEASURE_INDEX, FILTER_PREDICATE>;
+        else if (filter == FILTER_NULLS)
+            return &UnPivot::unpivotRows<Value, MEASURE_INDEX, FILTER_NULLS>;
+        else
+            return &UnPivot::unpivotRows<Value, MEASURE_INDEX, FILTER_NONE>;
+    }
+
+    template <class Value>
+    UnPivotRowsFunc chooseRows()
+    {
+        if (measureIndex)
+            return chooseFilterRows<Value, true>();
+        else
+            return chooseFilterRows<Value, false>();
+    }
+
+    void chooseRowsFunc(const SizedColumnTypes &input_types)
+    {
+        if (groupSize > 1)
+        {
+            for(int position = 0; position < groupSize; position++)
+            {
+                const VerticaType &valueType = input_types.getColumnType(position);
+                if (valueType.isFloat())
+                    addValueFuncs<FloatValue>();
+                else if (valueType.isNumeric())
+                    addValueFuncs<NumericValue>();
+                else if (valueType.isBool())
+                    addValueFuncs<BoolValue>();
+                else if (isUnPivotStringType(valueType))
+                    addValueFuncs<StringValue>();
+                else
+                    addValueFuncs<IntValue>();
+            }
+            unpivotRowsFunc = measureIndex? chooseFilterGroups<true>() : chooseFilterGroups<false>();
+        }
+        else if (measureType.isFloat())
+            unpivotRowsFunc = chooseRows<FloatValue>();
+        else if (measureType.isNumeric())
+            unpivotRowsFunc = chooseRows<NumericValue>();
+        else if (measureType.isBool())
+            unpivotRowsFunc = chooseRows<BoolValue>();
+        else if (isUnPivotStringType(measureType))
+            unpivotRowsFunc = chooseRows<StringValue>();
+        else
+            unpivotRowsFunc = chooseRows<IntValue>();
+    }
 
 public:
-    UnPivot(): measureType(VUnspecOID, 0), measureNamesCount(0), columnNames(NULL)
+    UnPivot(): measureType(VUnspecOID, 0), measureNamesCount(0), groupSize(1), compareFunc(NULL), columnNames(NULL), measureIndex(false), filter(FILTER_NONE), unpivotRowsFunc(NULL)
     {
     }
 
 	virtual void setup (ServerInterface &srvInterface, const SizedColumnTypes &input_types)
     {
         // check arguments
-        measureNamesCount = input_types.getColumnCount();
-        if ( measureNamesCount  < 1 ) 
-            vt_report_error(0, "There should be more than 1 arguments, but [%s] arguments are provided!", input_types.getColumnCount());
-
+        ParamReader paramReader = srvInterface.getParamReader();
+        groupSize = getUnPivotGroupSize(paramReader, input_types);
+        checkUnPivotArguments(input_types, groupSize);
+        measureNamesCount = input_types.getColumnCount() / groupSize;
         measureType = input_types.getColumnType(0);
-        for(int idx = 1; idx < measureNamesCount; idx++) 
+
+        // get parameters
+        if (paramReader.containsParameter("measureIndex"))
+            measureIndex = paramReader.getBoolRef("measureIndex") == vbool_true;
+        if (paramReader.containsParameter("includeNulls") && paramReader.getBoolRef("includeNulls") == vbool_false)
+            filter = FILTER_NULLS;
+        if (paramReader.containsParameter("predicate"))
         {
-            VerticaType measureTypeOther = input_types.getColumnType(1);
-            if ( measureTypeOther != measureType )
-                vt_report_error(0, "All type of arguments should same!");
+            parseUnPivotPredicate(paramReader.getStringRef("predicate").str(), measureType, predicate);
+            filter = FILTER_PREDICATE;
         }
+        if (paramReader.containsParameter("profile"))
+            profile.enabled = paramReader.getBoolRef("profile") == vbool_true;
+        chooseRowsFunc(input_types);
+        if (measureIndex)
+            return;
 
-        // get parameters
-        ParamReader paramReader = srvInterface.getParamReader();
         std::string separator = DEFAULT_separator;
         if (paramReader.containsParameter("separator"))
             separator = paramReader.getStringRef("separator").str();
@@ -70,11 +534,16 @@ public:
         else
         {
             // TODO: getColumnName if there is no measureNames paramter
+            vt_report_error(0, "There should be [%d] names in parameter [measureNames], but [%d] names are provided!", measureNamesCount, measureNamesCountFromParameter);
         }
     }
 
 	virtual void destroy (ServerInterface &srvInterface, const SizedColumnTypes &input_types)
     {
+        // note: values skipped by filters only reduce output rows, and there is no lookup or accumulation to time.
+        profile.outputCells = profile.outputRows * (1 + groupSize);
+        profile.logOutput(srvInterface, "UnPivot");
+
         if( columnNames != NULL ) 
         {
 		    delete[] columnNames;
@@ -87,36 +556,15 @@ public:
                                   PartitionWriter &output_writer)
     {
         // check arguments
-        if ((int)input_reader.getNumCols() != measureNamesCount)
-            vt_report_error(0, "There should be [%zu] arguments, but [%zu] arguments are provided!", measureNamesCount, input_reader.getNumCols());
+        if ((int)input_reader.getNumCols() != measureNamesCount * groupSize)
+            vt_report_error(0, "There should be [%d] arguments, but [%zu] arguments are provided!", measureNamesCount * groupSize, input_reader.getNumCols());
 
         // output: convert columns to rows
-        do 
-        {
-            for(int idx = 0; idx < measureNamesCount; idx++) 
-            {
-                output_writer.getStringRef(0).copy(columnNames[idx].c_str());
-
-                if (measureType.isInt()) 
-                {
-                    output_writer.setInt(1, input_reader.getIntRef(idx));
-                }
-                else if (measureType.isFloat()) 
-                {
-                    output_writer.setFloat(1, input_reader.getFloatRef(idx));
-                }
-                else if (measureType.isDate())
-                {
-                    output_writer.setDate(1, input_reader.getDateRef(idx));
-                }
-                else if (measureType.isNumeric()) 
-                {
-                    output_writer.getNumericRef(1).copy(input_reader.getNumericPtr(idx));
-                }
-
-                output_writer.next();
-            }
-        } while (input_reader.next());
+        uint64 mark = 0;
+        profile.start(mark);
+        profile.partitions++;
+        (this->*unpivotRowsFunc)(input_reader, output_writer);
+        profile.lap(profile.outputCycles, mark);
     }
 };
 
@@ -138,27 +586,27 @@ class UnPivotFactory : public TransformFunctionFactory
                                SizedColumnTypes &output_types)
     {
         // check arguments
-        int measureNamesCount = input_types.getColumnCount();
-        if ( measureNamesCount  < 1 ) 
-            vt_report_error(0, "There should be more than 1 arguments, but [%zu] arguments are provided!", input_types.getColumnCount());
-
+        ParamReader paramReader = srvInterface.getParamReader();
+        int groupSize = getUnPivotGroupSize(paramReader, input_types);
+        checkUnPivotArguments(input_types, groupSize);
         VerticaType measureType = input_types.getColumnType(0);
-        for(int idx = 1; idx < measureNamesCount; idx++) 
-        {
-            VerticaType measureTypeOther = input_types.getColumnType(1);
-            if ( measureTypeOther != measureType ) 
-                vt_report_error(0, "All type of arguments should same!");
-        }
 
         // get parameters
-        ParamReader paramReader = srvInterface.getParamReader();
+        bool measureIndex = false;
+        if (paramReader.containsParameter("measureIndex"))
+            measureIndex = paramReader.getBoolRef("measureIndex") == vbool_true;
+        if (paramReader.containsParameter("predicate"))
+        {
+            UnPivotPredicate predicate;
+            parseUnPivotPredicate(paramReader.getStringRef("predicate").str(), measureType, predicate);
+        }
         std::string separator = DEFAULT_separator;
         if (paramReader.containsParameter("separator"))
             separator = paramReader.getStringRef("separator").str();
         std::string measureNames = "";
         if (paramReader.containsParameter("measureNames"))
             measureNames = paramReader.getStringRef("measureNames").str();
-        else 
+        else if (!measureIndex)
             vt_report_error(0, "Function need at least parameter [measureNames]!");
 
         unsigned int length = 1;
@@ -169,17 +617,19 @@ class UnPivotFactory : public TransformFunctionFactory
             length = (token.length() > length)? token.length(): length;
 
         // output 
-        output_types.addVarchar(length, "measureName");
-        if (measureType.isInt()) 
-            output_types.addInt("meaureValue");
-        else if (measureType.isFloat()) 
-            output_types.addFloat("meaureValue");
-        else if (measureType.isDate())
-            output_types.addDate("meaureValue");
-        else if (measureType.isNumeric()) 
-            output_types.addNumeric(measureType.getNumericPrecision(), measureType.getNumericScale(), "meaureValue");
+        if (measureIndex)
+            output_types.addInt("measureIndex");
         else
-            vt_report_error(0, "Unkown type of 2 arguments: %s !", measureType.getTypeStr());
+            output_types.addVarchar(length, "measureName");
+        // note: value columns are named meaureValue1, meaureValue2, ... for groups
+        for(int position = 0; position < groupSize; position++)
+        {
+            std::stringstream valueName;
+            valueName << "meaureValue";
+            if (groupSize > 1)
+                valueName << position + 1;
+            addUnPivotValueType(output_types, input_types, position, groupSize, valueName.str());
+        }
     }
 
     // Defines the parameters for this UDSF. Works similarly to defining
@@ -189,6 +639,16 @@ class UnPivotFactory : public TransformFunctionFactory
         //parameter: separator string for columnNames, default value is ','.
         parameterTypes.addVarchar(255, "measureNames");
         parameterTypes.addVarchar(1, "separator");
+        //parameter: output 1-based index of measure instead of its name, default value is false.
+        parameterTypes.addBool("measureIndex");
+        //parameter: output rows of NULL values, default value is true.
+        parameterTypes.addBool("includeNulls");
+        //parameter: only output rows of values matching predicate such as '<> 0', NULL values never match.
+        parameterTypes.addVarchar(255, "predicate");
+        //parameter: count of arguments in each group output in one row, default value is 1.
+        parameterTypes.addInt("groupSize");
+        //parameter: log counters and timers of hot path when function instance is destroyed, default value is false.
+        parameterTypes.addBool("profile");
     }
 
 
@@ -84,6 +84,16 @@ where d.date >= '2003-01-01' and d.date <= '2003-01-03'
 order by 1 
 ;
 
+-- multiple methods in one pass
+select call_center_key, 
+  pivot(d.date::varchar, sales_dollar_amount using parameters columnsFilter = '2003-01-01,2003-01-02,2003-01-03', method = 'SUM,MIN,MAX,COUNT,AVG') over(partition by call_center_key)
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
 -- less columns required than data
 select call_center_key, 
   pivot(d.date::varchar, sales_dollar_amount::int using parameters columnsFilter = '2003-01-01,2003-01-02,2003-01-03') over(partition by call_center_key) 
@@ -94,6 +104,119 @@ where d.date >= '2003-01-01' and d.date <= '2003-01-03'
 order by 1 
 ;
 
+-- many groups in one call by hashing
+select call_center_key, sum("2003-01-01") as "2003-01-01", sum("2003-01-02") as "2003-01-02", sum("2003-01-03") as "2003-01-03"
+from (
+select pivot(call_center_key, d.date::varchar, sales_dollar_amount::int using parameters columnsFilter = '2003-01-01,2003-01-02,2003-01-03', groupKeys = 1) over(partition best) 
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+  ) t
+group by call_center_key
+order by 1 
+;
+
+-- multiple phases, aggregated locally before merging
+select pivotmultiphase(call_center_key, d.date::varchar, sales_dollar_amount::int using parameters columnsFilter = '2003-01-01,2003-01-02,2003-01-03', groupKeys = 1, method = 'SUM,COUNT') over(partition auto) 
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
+-- columns generated from range
+select call_center_key, 
+  pivot(d.date::varchar, sales_dollar_amount::int using parameters columnsRange = '2003-01-01..2003-01-03') over(partition by call_center_key) 
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
+-- range ending near the largest integer stops without overflow, and maxColumns limits columnsFilter and columnsRange together: error
+select pivot(V, M using parameters columnsRange = '9223372036854775800..9223372036854775807..5') over() 
+from (select '9223372036854775805' V, 1 M from dual) t;
+select pivot(V, M using parameters columnsFilter = 'a,b,c', columnsRange = '1..2', maxColumns = 4) over() 
+from (select 'a' V, 1 M from dual) t;
+-- range starting after its end: error
+select pivot(V, M using parameters columnsRange = '10..1') over() 
+from (select '1' V, 1 M from dual) t;
+
+-- date as measureName without casting to varchar
+select call_center_key, 
+  pivot(d.date, sales_dollar_amount::int using parameters columnsRange = '2003-01-01..2003-01-03') over(partition by call_center_key) 
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
+-- last transaction type and first ship date of each day
+select call_center_key, 
+  pivot(d.date, f.transaction_type, s.date using parameters columnsRange = '2003-01-01..2003-01-03', method = 'LAST,FIRST') over(partition by call_center_key order by pos_transaction_number) 
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+  inner join date_dimension s on f.ship_date_key = s.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
+-- counters and timers of hot path logged into UDx log
+select call_center_key, 
+  pivot(d.date::varchar, sales_dollar_amount::int using parameters columnsFilter = '2003-01-01,2003-01-02,2003-01-03', profile = true) over(partition by call_center_key) 
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
+-- all columns packed in one varbinary column, and cells extracted from it
+select call_center_key, pivotcell(pivot, 1)::int as "2003-01-01_sum", pivotcell(pivot, 2)::int as "2003-01-01_count", pivotcell(pivot, 6)::int as "2003-01-03_count"
+from (
+select pivot(call_center_key, d.date, sales_dollar_amount::int using parameters columnsRange = '2003-01-01..2003-01-03', groupKeys = 1, method = 'SUM,COUNT', outputFormat = 'packed') over(partition by call_center_key) 
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+  ) t
+order by 1 
+;
+
+-- columns of cross product of transaction types and dates
+select call_center_key, 
+  pivot(transaction_type, d.date, sales_dollar_amount using parameters dimensions = 2, columnsFilter = 'purchase,return;', columnsRange = ';2003-01-01..2003-01-03') over(partition by call_center_key)
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-03' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
+-- 2 days of largest sales of each call center, and sales of other days
+select call_center_key, 
+  pivot(d.date, sales_dollar_amount using parameters columnsRange = '2003-01-01..2003-01-07', topK = 2, otherColumn = true) over(partition by call_center_key)
+from online_sales.online_sales_fact f 
+  inner join date_dimension d on f.sale_date_key = d.date_key 
+where d.date >= '2003-01-01' and d.date <= '2003-01-31' 
+  and call_center_key >= 1 and call_center_key <= 3 
+order by 1 
+;
+
+-- SUM with more digits than precision of measure reports error: 3 * 9e15 needs 19 digits, more than numeric(18,2)
+select pivot(k, v using parameters columnsFilter = 'a') over()
+from (
+  select 'a' as k, 9000000000000000.00::numeric(18,2) as v
+  union all select 'a', 9000000000000000.00::numeric(18,2)
+  union all select 'a', 9000000000000000.00::numeric(18,2)
+  ) t
+;
+
 -- more columns required than data
 select call_center_key, 
   pivot(d.date::varchar, sales_dollar_amount::numeric using parameters columnsFilter = '2003-01-01|2003-01-02|2003-01-03|2003-01-04', separator = '|') over(partition by call_center_key)
@@ -155,7 +278,53 @@ group by call_center_key
 order by 1, 2
 ;
 
+-- measure index instead of name
+select call_center_key, 
+  unpivot(sum(sales_dollar_amount::int), sum(ship_dollar_amount::int), sum(net_dollar_amount::int) using parameters measureIndex=true) over(partition by call_center_key)
+from online_sales.online_sales_fact f 
+where call_center_key >= 1 and call_center_key <= 3 
+group by call_center_key 
+order by 1, 2
+;
+
+-- skip NULL and zero values
+select key, unpivot(V1, V2, V3 using parameters measureNames='V1,V2,V3', includeNulls=false) over(partition by key)
+from (select 1 key, 1 V1, null::int V2, 0 V3 from dual) t
+order by 1, 2;
+
+select key, unpivot(V1, V2, V3 using parameters measureNames='V1,V2,V3', predicate='<> 0') over(partition by key)
+from (select 1 key, 1 V1, null::int V2, 0 V3 from dual) t
+order by 1, 2;
+
+-- numeric compared exactly beyond precision of float: only V1 matches
+select key, unpivot(V1, V2, V3 using parameters measureNames='V1,V2,V3', predicate='= 12345678901234567.89') over(partition by key)
+from (select 1 key, 12345678901234567.89::numeric(30,2) V1, 12345678901234567.88::numeric(30,2) V2, 12345678901234567.90::numeric(30,2) V3 from dual) t
+order by 1, 2;
+
+-- groups of columns in one row
+select call_center_key, 
+  unpivot(sum(sales_quantity::int), sum(sales_dollar_amount::int), sum(ship_quantity::int), sum(ship_dollar_amount::int) using parameters measureNames='sales,ship', groupSize=2) over(partition by call_center_key) as (measureName, quantity, amount)
+from online_sales.online_sales_fact f 
+where call_center_key >= 1 and call_center_key <= 3 
+group by call_center_key 
+order by 1, 2
+;
+
 -- for date type
 select key, unpivot(SJ1, SJ2 using parameters measureNames='SJ1|SJ2', separator ='|') over(partition by key)
 from (select 1 key, '2024-01-01'::date SJ1, '2024-01-02'::date SJ2 from dual) t
 order by 1, 2;
+
+-- for varchar type
+select key, unpivot(SJ1, SJ2 using parameters measureNames='SJ1|SJ2', separator ='|') over(partition by key)
+from (select 1 key, 'short'::varchar(5) SJ1, 'a longer value'::varchar(20) SJ2 from dual) t
+order by 1, 2;
+
+-- for timestamp and boolean type
+select key, unpivot(SJ1, SJ2 using parameters measureNames='SJ1|SJ2', separator ='|') over(partition by key)
+from (select 1 key, '2024-01-01 10:00:00'::timestamp SJ1, '2024-01-02 11:00:00'::timestamp SJ2 from dual) t
+order by 1, 2;
+
+select key, unpivot(B1, B2 using parameters measureNames='B1,B2') over(partition by key)
+from (select 1 key, true B1, false B2 from dual) t
+order by 1, 2;